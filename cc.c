@@ -0,0 +1,115 @@
+#include <string.h>
+#include "cc.h"
+#include "seqnum.h"
+
+/* ******************************************************************
+   Congestion window.  See cc.h.
+**********************************************************************/
+
+static const char *cc_names[] = { "none", "aimd", "newreno" };
+
+int cc_byname(const char *name)
+{
+  int i;
+
+  for (i = 0; i < (int)(sizeof(cc_names) / sizeof(cc_names[0])); i++)
+    if (strcmp(name, cc_names[i]) == 0)
+      return i;
+  return -1;
+}
+
+const char *cc_name(int mode)
+{
+  if (mode < 0 || mode >= (int)(sizeof(cc_names) / sizeof(cc_names[0])))
+    return "unknown";
+  return cc_names[mode];
+}
+
+void cc_init(struct cc *c, int mode, int maxwindow)
+{
+  c->mode = mode;
+  c->maxwindow = maxwindow;
+  c->cwnd = (mode == CC_NONE) ? maxwindow : CC_INITIAL;
+  c->ssthresh = maxwindow;
+  c->recovering = 0;
+  c->hole = 0;
+  c->recover = (uint32_t)-1;  /* before the first packet */
+  c->rtorecover = 0;
+  c->nreductions = 0;
+}
+
+int cc_window(const struct cc *c)
+{
+  if (c->mode == CC_NONE || c->cwnd >= c->maxwindow)
+    return c->maxwindow;
+  return (c->cwnd < 1.0) ? 1 : (int)c->cwnd;
+}
+
+/* half the packets in flight, the new ssthresh */
+static double cc_half(int flight)
+{
+  return (flight / 2.0 < CC_MINTHRESH) ? CC_MINTHRESH : flight / 2.0;
+}
+
+int cc_ack(struct cc *c, int acked, uint32_t base)
+{
+  if (c->mode == CC_NONE || acked <= 0)
+    return 0;
+  if (c->recovering) {
+    if (seq_le(base, c->hole))
+      return 0;
+    if (c->mode == CC_NEWRENO && seq_le(base, c->recover)) {
+      c->hole = base;
+      return 1;
+    }
+    /* the window is already down at ssthresh */
+    c->recovering = 0;
+    return 0;
+  }
+  if (c->cwnd < c->ssthresh)
+    c->cwnd += acked;
+  else
+    c->cwnd += acked / c->cwnd;
+  if (c->cwnd > c->maxwindow)
+    c->cwnd = c->maxwindow;
+  return 0;
+}
+
+int cc_loss(struct cc *c, int flight, uint32_t base, uint32_t next)
+{
+  if (c->mode == CC_NONE)
+    return 0;
+  if (c->mode == CC_NEWRENO && seq_le(base, c->recover))
+    return 0;
+  c->ssthresh = cc_half(flight);
+  c->cwnd = c->ssthresh;
+  c->recovering = 1;
+  c->hole = base;
+  c->recover = next - 1;
+  c->rtorecover = 0;
+  c->nreductions++;
+  return 1;
+}
+
+void cc_timeout(struct cc *c, int flight, uint32_t seq, uint32_t next)
+{
+  if (c->mode == CC_NONE)
+    return;
+  /* a packet resent after a timeout that times out again, or another */
+  /* packet sent before it, leaves ssthresh where the first one put it */
+  if (!c->rtorecover || !seq_le(seq, c->recover)) {
+    c->ssthresh = cc_half(flight);
+    c->nreductions++;
+  }
+  c->cwnd = CC_INITIAL;
+  c->recovering = 0;
+  c->recover = next - 1;
+  c->rtorecover = 1;
+}
+
+void cc_stats(const struct cc *c, struct sim_stats *st)
+{
+  st->cwnd = c->cwnd;
+  st->ssthresh = c->ssthresh;
+  st->cwnd_reductions = c->nreductions;
+}
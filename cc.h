@@ -0,0 +1,82 @@
+/* ******************************************************************
+   Congestion window of a sender.
+
+   The flow control window only keeps the receiver's buffer from
+   overflowing: a sender behind a bottleneck keeps the whole window in
+   flight whatever the link can take, overflows its queue, and resends
+   the window again after every loss.  With congestion control the
+   sender also keeps no more than cwnd packets in flight, and adjusts
+   cwnd the way TCP does (RFC 5681):
+
+   - slow start: below ssthresh, cwnd grows by one for every packet
+     acknowledged, doubling every round trip
+   - congestion avoidance: from ssthresh on, by one every round trip
+   - a fast retransmit (duplicate ACKs) halves it: ssthresh becomes
+     half the packets in flight, and cwnd ssthresh
+   - a timeout takes cwnd back to one packet and slow starts again up
+     to half the packets that were in flight
+
+   CC_AIMD is Reno: every fast retransmit halves the window, even one
+   for another loss of the window already halved for, and the ACK of
+   the lost packet ends the recovery.  CC_NEWRENO (RFC 6582) halves it
+   once per window of data: losses of packets sent before the cut do
+   not count again, the recovery only ends once the ACKs reach the
+   last packet sent before it, and partial ACKs short of that do not
+   grow the window but tell the sender to resend the next hole.
+   Neither inflates the window by the duplicate ACKs.
+
+   cwnd starts at one packet and ssthresh at the flow control window,
+   which also caps cwnd.  CC_NONE leaves the flow control window alone.
+**********************************************************************/
+#ifndef CC_H
+#define CC_H
+
+#include <stdint.h>
+#include "emulator.h"
+
+#define CC_NONE    0
+#define CC_AIMD    1
+#define CC_NEWRENO 2
+
+#define CC_INITIAL   1.0  /* cwnd at the start and after a timeout */
+#define CC_MINTHRESH 2.0  /* smallest ssthresh */
+
+struct cc {
+  int mode;               /* CC_* */
+  int maxwindow;          /* the flow control window */
+  double cwnd, ssthresh;  /* in packets */
+  int recovering;         /* in fast recovery */
+  uint32_t hole;          /* of the packet it is waiting for */
+  uint32_t recover;       /* the last packet sent before the reduction */
+  int rtorecover;         /* which was a timeout */
+  int nreductions;
+};
+
+/* map between algorithm names ("none", "aimd", "newreno") and CC_* */
+/* codes; cc_byname returns -1 if unknown                           */
+extern int cc_byname(const char *name);
+extern const char *cc_name(int mode);
+
+extern void cc_init(struct cc *c, int mode, int maxwindow);
+
+/* the packets that may be in flight: the flow control window, or */
+/* cwnd rounded down if smaller, but at least one                 */
+extern int cc_window(const struct cc *c);
+
+/* acked packets were newly acknowledged, and base is the first one  */
+/* still unacknowledged; nonzero for a NewReno partial ACK, when base */
+/* is the next hole and the sender should resend it                   */
+extern int cc_ack(struct cc *c, int acked, uint32_t base);
+
+/* duplicate ACKs reported base lost with flight packets in flight and */
+/* next the next sequence number to be used; nonzero if that reduced   */
+/* the window                                                          */
+extern int cc_loss(struct cc *c, int flight, uint32_t base, uint32_t next);
+
+/* the timer of packet seq went off, with flight packets in flight */
+extern void cc_timeout(struct cc *c, int flight, uint32_t seq, uint32_t next);
+
+/* publish the window in the simulation's statistics */
+extern void cc_stats(const struct cc *c, struct sim_stats *st);
+
+#endif
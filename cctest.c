@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "sim.h"
+#include "cc.h"
+
+/* ******************************************************************
+   Check of the congestion window against the retransmission timeout:
+   runs both protocols with each congestion control on a lossy channel
+   and on a bottleneck link, and fails if the round trip estimate ran
+   away from the round trips the channel can have.  A sender that took
+   a sample on a packet held back from a resend measured the whole
+   loss recovery, and its timeout grew until the transfer stalled.
+
+   Also runs Go-Back-N without congestion control with a window far
+   larger than the round trips the channel can carry, and fails if it
+   does not deliver every message or resent more than MAXRESENDS
+   packets per message: a timeout that could not back off far enough,
+   or resent the whole window every time, put packets into the channel
+   faster than it drained, until the events ran out of memory.
+
+   usage: cctest
+
+   Prints one line per run and exits with status 1 if any failed.
+
+   Build:  gcc -O2 -o cctest cctest.c pktbuf.c emulator.c sched.c
+           channel.c rng.c trace.c hist.c wheel.c rto.c sendq.c
+           transport.c gbn.c sr.c checksum.c cc.c -lm -lpthread
+**********************************************************************/
+
+#define MAXSRTT 64.0    /* four times the RTT the protocols assume */
+#define MAXBASE 128.0   /* SRTT + 4 RTTVAR, before any backoff */
+#define NSTREAMS 4      /* random streams every configuration runs on */
+#define BIGWINDOW 1024  /* window of the large-window run */
+#define MAXRESENDS 128  /* resends per message it may take */
+
+static const char *protocols[] = { "gbn", "sr" };
+static const int ccs[] = { CC_AIMD, CC_NEWRENO };
+
+/* run cfg and check the estimator at the end; nonzero if it failed */
+static int check(struct sim_config *cfg, const char *what)
+{
+  struct sim_ctx *sim = sim_create(cfg);
+  const struct sim_stats *st;
+  int failed;
+
+  if (sim == NULL) {
+    printf("%s: simulation not created\n", what);
+    return 1;
+  }
+  sim_run(sim);
+  st = &sim->stats;
+  failed = st->rtt_samples == 0 || st->srtt > MAXSRTT ||
+           st->srtt + 4 * st->rttvar > MAXBASE;
+  printf("%s %s %s sack %d stream %u: %d delivered, srtt %f rttvar %f rto %f "
+         "after %d samples%s\n",
+         what, cfg->transport->name, cc_name(cfg->proto.cc), cfg->proto.sack, cfg->stream,
+         st->messages_delivered, st->srtt, st->rttvar, st->rto, st->rtt_samples,
+         failed ? "  FAILED" : "");
+  sim_destroy(sim);
+  return failed;
+}
+
+/* run cfg and check that it delivered every message without too many */
+/* resends; nonzero if not                                             */
+static int deliver(struct sim_config *cfg, const char *what)
+{
+  struct sim_ctx *sim = sim_create(cfg);
+  const struct sim_stats *st;
+  int failed;
+
+  if (sim == NULL) {
+    printf("%s: simulation not created\n", what);
+    return 1;
+  }
+  sim_run(sim);
+  st = &sim->stats;
+  failed = st->messages_delivered != cfg->nsimmax ||
+           st->packets_resent > MAXRESENDS * cfg->nsimmax;
+  printf("%s %s window %d stream %u: %d of %d delivered, %d resends, "
+         "ended at %f%s\n",
+         what, cfg->transport->name, cfg->proto.windowsize, cfg->stream,
+         st->messages_delivered, cfg->nsimmax, st->packets_resent, sim->time,
+         failed ? "  FAILED" : "");
+  sim_destroy(sim);
+  return failed;
+}
+
+int main(void)
+{
+  struct sim_config cfg;
+  int ip, ic, sack, failed = 0;
+  unsigned int stream;
+
+  for (ip = 0; ip < (int)(sizeof(protocols) / sizeof(protocols[0])); ip++)
+    for (ic = 0; ic < (int)(sizeof(ccs) / sizeof(ccs[0])); ic++)
+      for (sack = 0; sack <= 1; sack++)
+        for (stream = 0; stream < NSTREAMS; stream++) {
+          /* losses and corruption on the assignment's channel */
+          sim_defaults(&cfg);
+          cfg.transport = transport_byname(protocols[ip]);
+          cfg.rng = RNG_XOSHIRO;
+          cfg.stream = stream;
+          cfg.trace = 0;
+          cfg.nsimmax = 1500;
+          cfg.lossprob = 0.2;
+          cfg.corruptprob = 0.1;
+          cfg.corruptdirection = 2;
+          cfg.lambda = 10;
+          cfg.proto.cc = ccs[ic];
+          cfg.proto.sack = sack;
+          failed |= check(&cfg, "lossy");
+
+          /* a window far larger than the queue of a bottleneck */
+          cfg.nsimmax = 3000;
+          cfg.lossprob = 0.0;
+          cfg.corruptprob = 0.0;
+          cfg.lambda = 1;
+          cfg.proto.windowsize = 64;
+          cfg.proto.sendqueue = 1024;
+          cfg.link[A].bandwidth = cfg.link[B].bandwidth = 160;
+          cfg.link[A].qlimit = cfg.link[B].qlimit = 8;
+          cfg.link[A].propdelay = cfg.link[B].propdelay = 5;
+          failed |= check(&cfg, "bottleneck");
+        }
+  for (stream = 0; stream < NSTREAMS; stream++) {
+    /* a window queued up far beyond the initial timeout */
+    sim_defaults(&cfg);
+    cfg.transport = transport_byname("gbn");
+    cfg.rng = RNG_XOSHIRO;
+    cfg.stream = stream;
+    cfg.trace = 0;
+    cfg.nsimmax = 2000;
+    cfg.lossprob = 0.1;
+    cfg.corruptprob = 0.1;
+    cfg.corruptdirection = 2;
+    cfg.lambda = 1;
+    cfg.backpressure = 1;
+    cfg.proto.windowsize = BIGWINDOW;
+    cfg.proto.sendqueue = 64;
+    failed |= deliver(&cfg, "large window");
+  }
+  printf("%s\n", failed ? "FAILED" : "passed");
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,286 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "channel.h"
+
+/* ******************************************************************
+   Per-direction channel state.  See channel.h.
+**********************************************************************/
+
+static const char *aqm_names[] = { "droptail", "red" };
+static const char *loss_names[] = { "bernoulli", "ge" };
+
+int link_aqm_byname(const char *name)
+{
+  int i;
+
+  for (i = 0; i < (int)(sizeof(aqm_names) / sizeof(aqm_names[0])); i++)
+    if (strcmp(name, aqm_names[i]) == 0)
+      return i;
+  return -1;
+}
+
+const char *link_aqm_name(int aqm)
+{
+  if (aqm < 0 || aqm >= (int)(sizeof(aqm_names) / sizeof(aqm_names[0])))
+    return "unknown";
+  return aqm_names[aqm];
+}
+
+int link_loss_byname(const char *name)
+{
+  int i;
+
+  for (i = 0; i < (int)(sizeof(loss_names) / sizeof(loss_names[0])); i++)
+    if (strcmp(name, loss_names[i]) == 0)
+      return i;
+  return -1;
+}
+
+const char *link_loss_name(int loss)
+{
+  if (loss < 0 || loss >= (int)(sizeof(loss_names) / sizeof(loss_names[0])))
+    return "unknown";
+  return loss_names[loss];
+}
+
+void link_init(struct link *l, int src, int dst, const struct link_config *cfg)
+{
+  memset(l, 0, sizeof(struct link));
+  l->src = src;
+  l->dst = dst;
+  l->tail = 0.0;
+  if (cfg != NULL)
+    l->cfg = *cfg;
+  if (l->cfg.red_min <= 0.0)
+    l->cfg.red_min = 5.0;
+  if (l->cfg.red_max <= l->cfg.red_min)
+    l->cfg.red_max = 3.0 * l->cfg.red_min;
+  if (l->cfg.red_maxp <= 0.0)
+    l->cfg.red_maxp = 0.1;
+  if (l->cfg.red_weight <= 0.0)
+    l->cfg.red_weight = 0.002;
+  if (l->cfg.ge_bad <= 0.0)
+    l->cfg.ge_bad = 1.0;
+  if (l->cfg.reorder_depth <= 0)
+    l->cfg.reorder_depth = 3;
+  if (l->cfg.reorder_depth > LINK_REORDER_MAX) {
+    printf("Warning: reorder depth %d too large, using %d\n", l->cfg.reorder_depth,
+           LINK_REORDER_MAX);
+    l->cfg.reorder_depth = LINK_REORDER_MAX;
+  }
+}
+
+void link_destroy(struct link *l)
+{
+  free(l->done);
+  free(l->size);
+  l->done = NULL;
+  l->size = NULL;
+  l->count = l->ringsize = 0;
+}
+
+float link_lastarrival(const struct link *l, float now)
+{
+  return (l->tail > now) ? l->tail : now;
+}
+
+void link_schedule(struct link *l, float arrival)
+{
+  /* a packet that overtook others leaves the tail where it was */
+  if (arrival > l->tail)
+    l->tail = arrival;
+  l->histpos = (l->histpos + 1) % (LINK_REORDER_MAX + 1);
+  l->history[l->histpos] = l->tail;
+}
+
+
+/********* Impairments ************/
+
+int link_impaired(const struct link *l)
+{
+  return l->cfg.loss != LOSS_BERNOULLI || l->cfg.reorder > 0.0 || l->cfg.dup > 0.0;
+}
+
+int link_ge_lose(struct link *l, struct rng *rng)
+{
+  if (rng_uniform(rng) < (l->ge_bad ? l->cfg.ge_r : l->cfg.ge_p))
+    l->ge_bad = !l->ge_bad;
+  return rng_uniform(rng) < (l->ge_bad ? l->cfg.ge_bad : l->cfg.ge_good);
+}
+
+void link_count_loss(struct link *l, int lost)
+{
+  if (lost) {
+    l->lost++;
+    if (!l->lastlost)
+      l->bursts++;
+  }
+  l->lastlost = lost;
+}
+
+int link_reorders(struct link *l, struct rng *rng)
+{
+  if (l->cfg.reorder <= 0.0 || rng_uniform(rng) >= l->cfg.reorder)
+    return 0;
+  l->reordered++;
+  return 1;
+}
+
+float link_reorder_after(const struct link *l, float now)
+{
+  float t;
+
+  /* behind every packet but the last reorder_depth */
+  t = l->history[(l->histpos + LINK_REORDER_MAX + 1 - l->cfg.reorder_depth) %
+                 (LINK_REORDER_MAX + 1)];
+  return (t > now) ? t : now;
+}
+
+int link_duplicates(struct link *l, struct rng *rng)
+{
+  if (l->cfg.dup <= 0.0 || rng_uniform(rng) >= l->cfg.dup)
+    return 0;
+  l->duplicated++;
+  return 1;
+}
+
+
+/********* Rated links ************/
+
+/* packets sent by now leave the queue */
+static void link_expire(struct link *l, double now)
+{
+  while (l->count > 0 && l->done[l->first] <= now) {
+    l->area += l->count * (l->done[l->first] - l->since);
+    l->since = l->done[l->first];
+    l->bytes -= l->size[l->first];
+    l->first = (l->first + 1) & (l->ringsize - 1);
+    l->count--;
+  }
+}
+
+static void link_grow(struct link *l)
+{
+  int size = l->ringsize ? 2 * l->ringsize : 64, i;
+
+  /* unwrap into a ring twice the size */
+  l->done = realloc(l->done, size * sizeof(double));
+  l->size = realloc(l->size, size * sizeof(int));
+  if (l->done == NULL || l->size == NULL) {
+    printf("memory allocation for the link queue failed.");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < l->first; i++) {
+    l->done[l->ringsize + i] = l->done[i];
+    l->size[l->ringsize + i] = l->size[i];
+  }
+  l->ringsize = size;
+}
+
+/* whether RED drops a packet of bytes bytes arriving at now */
+static int red_drop(struct link *l, double now, int bytes, struct rng *rng)
+{
+  const struct link_config *c = &l->cfg;
+  double pb, pa;
+
+  /* an idle link ages the average as if small packets had gone by */
+  if (l->count == 0 && now > l->busy)
+    l->red_avg *= pow(1.0 - c->red_weight, (now - l->busy) * c->bandwidth / (8.0 * bytes));
+  else
+    l->red_avg += c->red_weight * (l->count - l->red_avg);
+
+  if (l->red_avg < c->red_min) {
+    l->red_count = 0;
+    return 0;
+  }
+  if (l->red_avg >= c->red_max) {
+    l->red_count = 0;
+    return 1;
+  }
+  /* spread the drops out: the longer since the last, the likelier */
+  pb = c->red_maxp * (l->red_avg - c->red_min) / (c->red_max - c->red_min);
+  pa = (l->red_count * pb < 1.0) ? pb / (1.0 - l->red_count * pb) : 1.0;
+  if (rng_uniform(rng) < pa) {
+    l->red_count = 0;
+    return 1;
+  }
+  l->red_count++;
+  return 0;
+}
+
+int link_send(struct link *l, double now, int bytes, struct rng *rng, double *arrival)
+{
+  double start;
+  int i;
+
+  link_expire(l, now);
+  if (l->cfg.aqm == LINK_RED && red_drop(l, now, bytes, rng)) {
+    l->reddrops++;
+    return LINK_REDDROP;
+  }
+  if ((l->cfg.qlimit > 0 && l->count >= l->cfg.qlimit) ||
+      (l->cfg.qbytes > 0 && l->bytes + bytes > l->cfg.qbytes)) {
+    l->taildrops++;
+    return LINK_TAILDROP;
+  }
+
+  start = (l->busy > now) ? l->busy : now;
+  l->busy = start + bytes * 8.0 / l->cfg.bandwidth;
+  if (l->count == l->ringsize)
+    link_grow(l);
+  l->area += l->count * (now - l->since);
+  l->since = now;
+  i = (l->first + l->count++) & (l->ringsize - 1);
+  l->done[i] = l->busy;
+  l->size[i] = bytes;
+  l->bytes += bytes;
+  if (l->count > l->maxdepth)
+    l->maxdepth = l->count;
+  l->sent++;
+  l->sentbytes += bytes;
+  *arrival = l->busy + l->cfg.propdelay;
+  return LINK_SENT;
+}
+
+int link_depth(const struct link *l, double now)
+{
+  int i, n = l->count;
+
+  for (i = 0; i < l->count && l->done[(l->first + i) & (l->ringsize - 1)] <= now; i++)
+    n--;
+  return n;
+}
+
+double link_depth_mean(const struct link *l, double now)
+{
+  double area = l->area, since = l->since, t;
+  int i, n = l->count;
+
+  if (now <= 0.0)
+    return 0.0;
+  /* the packets sent since the last change, as link_expire would */
+  for (i = 0; i < l->count; i++) {
+    t = l->done[(l->first + i) & (l->ringsize - 1)];
+    if (t > now)
+      break;
+    area += n-- * (t - since);
+    since = t;
+  }
+  if (now > since)
+    area += n * (now - since);
+  return area / now;
+}
+
+double link_utilization(const struct link *l, double now)
+{
+  double busytime;
+
+  if (!link_rated(l) || now <= 0.0)
+    return 0.0;
+  busytime = l->sentbytes * 8.0 / l->cfg.bandwidth;
+  if (l->busy > now)
+    busytime -= l->busy - now;
+  return busytime / now;
+}
@@ -0,0 +1,161 @@
+/* ******************************************************************
+   Per-direction channel state for the network emulator.
+
+   Each direction of the A<->B channel is a struct link, indexed by
+   the sending entity.  By default a link is the medium of the
+   assignment: every packet takes 1 to 10 time units, and the link
+   only remembers when the last packet it carries will arrive, which
+   lets tolayer3() keep the medium FIFO without searching the event
+   list.
+
+   A link with a bandwidth is a bottleneck instead.  A packet waits in
+   the link's queue behind the packets sent before it, takes its size
+   over the bandwidth to serialize, and arrives propdelay later; the
+   random delay of the assignment goes away.  The queue holds at most
+   qlimit packets and qbytes bytes, counting the packet being sent,
+   and drops what does not fit (drop-tail).  With LINK_RED it also
+   drops early, with Random Early Detection (Floyd and Jacobson): an
+   average of the queue length between red_min and red_max packets
+   drops an arriving packet with a probability rising to red_maxp.
+   Losses of the medium hit packets after the queue took them, so a
+   lost packet still used its share of the link.
+
+   Besides the independent losses of lossprob (LOSS_BERNOULLI), a link
+   can lose packets in bursts with the Gilbert-Elliott model
+   (LOSS_GE): a Markov chain of a good and a bad state, each with its
+   own loss probability, that goes bad with probability ge_p and good
+   again with ge_r at every packet, so bursts last 1/ge_r packets on
+   average.  It replaces lossprob, and corruptdirection, on its link.
+   A link can also reorder packets: one in reorder of them may
+   overtake up to reorder_depth packets sent before it.  And it can
+   duplicate them: one in dup arrives twice, as if sent twice.
+**********************************************************************/
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include "rng.h"
+
+#define LINK_DROPTAIL 0
+#define LINK_RED      1
+
+#define LOSS_BERNOULLI 0
+#define LOSS_GE        1
+
+#define LINK_REORDER_MAX 64 /* largest reorder_depth */
+
+/* parameters of one direction; zero means the default */
+struct link_config {
+  double bandwidth;       /* bits per time unit, 0 for the assignment's */
+                          /* random delay without rate or queue         */
+  double propdelay;       /* propagation delay, in time units */
+  int qlimit;             /* packets the queue holds, 0 for no limit */
+  int qbytes;             /* bytes it holds, 0 for no limit */
+  int aqm;                /* LINK_DROPTAIL or LINK_RED */
+  double red_min;         /* RED thresholds of the average queue, in */
+  double red_max;         /* packets; 5 and 3 red_min by default      */
+  double red_maxp;        /* drop probability at red_max, 0.1 */
+  double red_weight;      /* weight of a new sample in the average, */
+                          /* 0.002                                   */
+  int loss;               /* LOSS_BERNOULLI or LOSS_GE */
+  double ge_p;            /* Gilbert-Elliott: good to bad state, per */
+  double ge_r;            /* packet, and bad to good                  */
+  double ge_good;         /* loss probability in the good state, 0 */
+  double ge_bad;          /* and in the bad state, 1 by default */
+  double reorder;         /* probability that a packet may overtake */
+  int reorder_depth;      /* up to this many packets, 3 by default */
+  double dup;             /* probability that a packet arrives twice */
+};
+
+/* map between queue discipline names ("droptail", "red") and LINK_* */
+/* codes, and loss model names ("bernoulli", "ge") and LOSS_* codes;  */
+/* the byname functions return -1 if unknown                         */
+extern int link_aqm_byname(const char *name);
+extern const char *link_aqm_name(int aqm);
+extern int link_loss_byname(const char *name);
+extern const char *link_loss_name(int loss);
+
+struct link {
+  int src;                /* sending entity, A or B */
+  int dst;                /* receiving entity */
+  float tail;             /* arrival time of the last packet scheduled */
+  float history[LINK_REORDER_MAX + 1]; /* tail after each of the last */
+  int histpos;            /* packets, most recent at histpos           */
+  struct link_config cfg;
+  int ge_bad;             /* Gilbert-Elliott chain in the bad state */
+
+  /* the queue: when each packet in it will have been sent, and its */
+  /* size, oldest first                                             */
+  double *done;
+  int *size;
+  int first, count, ringsize; /* ringsize is a power of two */
+  int bytes;              /* bytes in the queue */
+  double busy;            /* when the link has sent all of them */
+  double red_avg;         /* RED average queue length */
+  int red_count;          /* packets accepted since the last RED drop */
+
+  /* statistics */
+  int sent;               /* packets the queue took */
+  long long sentbytes;
+  int taildrops;          /* dropped by a full queue */
+  int reddrops;           /* dropped early by RED */
+  int maxdepth;           /* most packets in the queue */
+  double since;           /* time of the last change of count */
+  double area;            /* integral of count over time up to then */
+  int lost;               /* lost on the link, by either model */
+  int bursts;             /* runs of consecutive losses */
+  int lastlost;           /* the last packet was lost */
+  int reordered;          /* packets allowed to overtake */
+  int duplicated;
+};
+
+extern void link_init(struct link *l, int src, int dst, const struct link_config *cfg);
+extern void link_destroy(struct link *l);
+
+/* nonzero for a link with a bandwidth and a queue */
+static inline int link_rated(const struct link *l)
+{
+  return l->cfg.bandwidth > 0.0;
+}
+
+/* earliest time a packet sent at now may be scheduled after, so that */
+/* it cannot overtake a packet already in flight                      */
+extern float link_lastarrival(const struct link *l, float now);
+
+/* record the arrival time of a packet put on the link */
+extern void link_schedule(struct link *l, float arrival);
+
+/* nonzero for a link with any of the impairments above */
+extern int link_impaired(const struct link *l);
+
+/* whether the Gilbert-Elliott chain of the link loses the next packet */
+extern int link_ge_lose(struct link *l, struct rng *rng);
+
+/* count a packet lost or not, for the loss burst statistics */
+extern void link_count_loss(struct link *l, int lost);
+
+/* whether the next packet may overtake others, from rng if reorder */
+/* is set, and the time it must arrive after if so                  */
+extern int link_reorders(struct link *l, struct rng *rng);
+extern float link_reorder_after(const struct link *l, float now);
+
+/* whether the next packet is duplicated, from rng if dup is set */
+extern int link_duplicates(struct link *l, struct rng *rng);
+
+#define LINK_SENT      0
+#define LINK_TAILDROP  1  /* the queue was full */
+#define LINK_REDDROP   2  /* RED dropped the packet early */
+
+/* put a packet of bytes bytes sent at now into the queue of a rated */
+/* link; LINK_SENT with its arrival time at the other end, or why    */
+/* the queue dropped it.  LINK_RED draws from rng                    */
+extern int link_send(struct link *l, double now, int bytes, struct rng *rng,
+                     double *arrival);
+
+/* packets in the queue at now, and their time average up to now */
+extern int link_depth(const struct link *l, double now);
+extern double link_depth_mean(const struct link *l, double now);
+
+/* fraction of the time up to now the link was sending */
+extern double link_utilization(const struct link *l, double now);
+
+#endif
@@ -0,0 +1,266 @@
+#include <string.h>
+#include <pthread.h>
+#include "checksum.h"
+
+/* ******************************************************************
+   Packet checksums.  See checksum.h.
+**********************************************************************/
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CKSUM_X86 1
+#include <immintrin.h>
+#else
+#define CKSUM_X86 0
+#endif
+
+#define CRC32C_POLY 0x82F63B78u  /* Castagnoli, bit reflected */
+#define INET_VECMIN 64           /* shorter buffers are summed faster */
+                                 /* without setting up the vectors    */
+
+static const char *cksum_names[] = { "sum", "inet", "crc32c" };
+
+int cksum_byname(const char *name)
+{
+  int i;
+
+  for (i = 0; i < (int)(sizeof(cksum_names) / sizeof(cksum_names[0])); i++)
+    if (strcmp(name, cksum_names[i]) == 0)
+      return i;
+  return -1;
+}
+
+const char *cksum_name(int kind)
+{
+  if (kind < 0 || kind >= (int)(sizeof(cksum_names) / sizeof(cksum_names[0])))
+    return "unknown";
+  return cksum_names[kind];
+}
+
+int cksum_cpu(void)
+{
+  int cpu = 0;
+
+#if CKSUM_X86
+  if (__builtin_cpu_supports("avx2"))
+    cpu |= CKSUM_CPU_AVX2;
+  if (__builtin_cpu_supports("sse4.2"))
+    cpu |= CKSUM_CPU_SSE42;
+#endif
+  return cpu;
+}
+
+int pkt_checksum(const struct pkt *packet, int kind)
+{
+  size_t len = 0;
+  uint64_t sum;
+  uint32_t crc;
+
+  /* a length out of range is summed as it is, over no payload */
+  if (packet->length > 0 && packet->length <= MAXPAYLOAD)
+    len = (size_t)packet->length;
+  switch (kind) {
+  case CKSUM_INET:
+    sum = cksum_inet_add(&packet->seqnum, sizeof(packet->seqnum), 0);
+    sum = cksum_inet_add(&packet->acknum, sizeof(packet->acknum), sum);
+    sum = cksum_inet_add(&packet->flags, sizeof(packet->flags), sum);
+    sum = cksum_inet_add(&packet->length, sizeof(packet->length), sum);
+    sum = cksum_inet_add(packet->payload, len, sum);
+    return cksum_inet_fold(sum);
+  case CKSUM_CRC32C:
+    crc = cksum_crc32c(&packet->seqnum, sizeof(packet->seqnum), 0);
+    crc = cksum_crc32c(&packet->acknum, sizeof(packet->acknum), crc);
+    crc = cksum_crc32c(&packet->flags, sizeof(packet->flags), crc);
+    crc = cksum_crc32c(&packet->length, sizeof(packet->length), crc);
+    crc = cksum_crc32c(packet->payload, len, crc);
+    return (int)crc;
+  default:
+    /* sequence numbers use all 32 bits */
+    sum = (uint32_t)packet->seqnum + (uint32_t)packet->acknum + (uint32_t)packet->flags +
+          (uint32_t)packet->length;
+    return (int)cksum_bytesum(packet->payload, len, (uint32_t)sum);
+  }
+}
+
+uint32_t cksum_bytesum(const void *buf, size_t len, uint32_t sum)
+{
+  const char *p = buf;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    sum += (int)p[i];
+  return sum;
+}
+
+
+/********* Internet checksum ************/
+
+uint64_t cksum_inet_add(const void *buf, size_t len, uint64_t sum)
+{
+  if (len >= INET_VECMIN && (cksum_cpu() & CKSUM_CPU_AVX2))
+    return cksum_inet_add_avx2(buf, len, sum);
+  return cksum_inet_add_scalar(buf, len, sum);
+}
+
+/* 2^16 is 1 modulo 2^16 - 1, so summing 32-bit words and folding the */
+/* carries back in at the end gives the sum of the 16-bit words        */
+uint64_t cksum_inet_add_scalar(const void *buf, size_t len, uint64_t sum)
+{
+  const unsigned char *p = buf;
+  uint32_t w;
+  uint16_t h;
+
+  for (; len >= 4; p += 4, len -= 4) {
+    memcpy(&w, p, 4);
+    sum += w;
+  }
+  if (len >= 2) {
+    memcpy(&h, p, 2);
+    sum += h;
+    p += 2;
+    len -= 2;
+  }
+  if (len > 0) {
+    /* a last odd byte is padded with a zero byte */
+    h = 0;
+    memcpy(&h, p, 1);
+    sum += h;
+  }
+  return sum;
+}
+
+uint16_t cksum_inet_fold(uint64_t sum)
+{
+  sum = (sum & 0xffffffff) + (sum >> 32);
+  sum = (sum & 0xffffffff) + (sum >> 32);
+  sum = (sum & 0xffff) + (sum >> 16);
+  sum = (sum & 0xffff) + (sum >> 16);
+  sum = (sum & 0xffff) + (sum >> 16);
+  return (uint16_t)~sum;
+}
+
+#if CKSUM_X86
+/* each 32-bit lane sums the two 16-bit words it holds, under 2^17 a */
+/* round, so the lanes are emptied into sum every INET_ROUNDS rounds */
+#define INET_ROUNDS (1 << 14)
+
+__attribute__((target("avx2")))
+uint64_t cksum_inet_add_avx2(const void *buf, size_t len, uint64_t sum)
+{
+  const unsigned char *p = buf;
+  const __m256i low = _mm256_set1_epi32(0xffff);
+  __m256i v, acc0, acc1;
+  uint32_t lane[8];
+  size_t n, i;
+
+  while (len >= 64) {
+    n = len / 64;
+    if (n > INET_ROUNDS / 2)
+      n = INET_ROUNDS / 2;
+    acc0 = _mm256_setzero_si256();
+    acc1 = _mm256_setzero_si256();
+    for (i = 0; i < n; i++, p += 64) {
+      v = _mm256_loadu_si256((const __m256i *)p);
+      acc0 = _mm256_add_epi32(acc0, _mm256_and_si256(v, low));
+      acc1 = _mm256_add_epi32(acc1, _mm256_srli_epi32(v, 16));
+      v = _mm256_loadu_si256((const __m256i *)(p + 32));
+      acc0 = _mm256_add_epi32(acc0, _mm256_and_si256(v, low));
+      acc1 = _mm256_add_epi32(acc1, _mm256_srli_epi32(v, 16));
+    }
+    len -= n * 64;
+    _mm256_storeu_si256((__m256i *)lane, _mm256_add_epi32(acc0, acc1));
+    for (i = 0; i < 8; i++)
+      sum += lane[i];
+  }
+  return cksum_inet_add_scalar(p, len, sum);
+}
+#else
+uint64_t cksum_inet_add_avx2(const void *buf, size_t len, uint64_t sum)
+{
+  return cksum_inet_add_scalar(buf, len, sum);
+}
+#endif
+
+
+/********* CRC-32C ************/
+
+uint32_t cksum_crc32c(const void *buf, size_t len, uint32_t crc)
+{
+  if (cksum_cpu() & CKSUM_CPU_SSE42)
+    return cksum_crc32c_sse42(buf, len, crc);
+  return cksum_crc32c_scalar(buf, len, crc);
+}
+
+/* slicing by 8 (Kounavis and Berry): crc32c_table[k][b] is the CRC */
+/* of byte b followed by k zero bytes                                */
+static uint32_t crc32c_table[8][256];
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_init(void)
+{
+  uint32_t c;
+  int i, k;
+
+  for (i = 0; i < 256; i++) {
+    c = (uint32_t)i;
+    for (k = 0; k < 8; k++)
+      c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+    crc32c_table[0][i] = c;
+  }
+  for (i = 0; i < 256; i++)
+    for (k = 1; k < 8; k++)
+      crc32c_table[k][i] = (crc32c_table[k - 1][i] >> 8) ^
+                           crc32c_table[0][crc32c_table[k - 1][i] & 0xff];
+}
+
+uint32_t cksum_crc32c_scalar(const void *buf, size_t len, uint32_t crc)
+{
+  const unsigned char *p = buf;
+  uint64_t w;
+
+  pthread_once(&crc32c_once, crc32c_init);
+  crc = ~crc;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  for (; len >= 8; p += 8, len -= 8) {
+    memcpy(&w, p, 8);
+    w ^= crc;
+    crc = crc32c_table[7][w & 0xff] ^ crc32c_table[6][(w >> 8) & 0xff] ^
+          crc32c_table[5][(w >> 16) & 0xff] ^ crc32c_table[4][(w >> 24) & 0xff] ^
+          crc32c_table[3][(w >> 32) & 0xff] ^ crc32c_table[2][(w >> 40) & 0xff] ^
+          crc32c_table[1][(w >> 48) & 0xff] ^ crc32c_table[0][w >> 56];
+  }
+#else
+  (void)w;
+#endif
+  for (; len > 0; p++, len--)
+    crc = crc32c_table[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+#if CKSUM_X86
+__attribute__((target("sse4.2")))
+uint32_t cksum_crc32c_sse42(const void *buf, size_t len, uint32_t crc)
+{
+  const unsigned char *p = buf;
+  uint64_t c = ~crc, w;
+  uint32_t h;
+
+  for (; len >= 8; p += 8, len -= 8) {
+    memcpy(&w, p, 8);
+    c = _mm_crc32_u64(c, w);
+  }
+  if (len >= 4) {
+    memcpy(&h, p, 4);
+    c = _mm_crc32_u32((uint32_t)c, h);
+    p += 4;
+    len -= 4;
+  }
+  for (; len > 0; p++, len--)
+    c = _mm_crc32_u8((uint32_t)c, *p);
+  return ~(uint32_t)c;
+}
+#else
+uint32_t cksum_crc32c_sse42(const void *buf, size_t len, uint32_t crc)
+{
+  return cksum_crc32c_scalar(buf, len, crc);
+}
+#endif
@@ -0,0 +1,65 @@
+/* ******************************************************************
+   Packet checksums, shared by the protocols.
+
+   - CKSUM_SUM     the sum of the header fields and the payload bytes
+                   the protocols have always computed.  Cheap, but it
+                   cannot see bytes that swapped places, or changes
+                   that cancel out
+   - CKSUM_INET    the 16-bit one's complement Internet checksum
+                   (RFC 1071), as IP, UDP and TCP use it.  It is blind
+                   to reordered 16-bit words too
+   - CKSUM_CRC32C  CRC-32C (Castagnoli), as iSCSI and SCTP use it: it
+                   catches every burst of up to 32 bits and reordered
+                   data
+
+   The kernels work on buffers of any length.  Where the CPU has them,
+   the Internet checksum sums 32 bytes at a time with AVX2 and CRC32C
+   uses the SSE4.2 crc32 instruction; the scalar versions stand in
+   elsewhere.  The kernel is picked on every call, from what the CPU
+   reported at startup.  See cksumbench.c for their speed.
+**********************************************************************/
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "emulator.h"
+
+#define CKSUM_SUM     0
+#define CKSUM_INET    1
+#define CKSUM_CRC32C  2
+
+/* map between checksum names ("sum", "inet", "crc32c") and CKSUM_* */
+/* codes; cksum_byname returns -1 if unknown                        */
+extern int cksum_byname(const char *name);
+extern const char *cksum_name(int kind);
+
+/* checksum of the header fields, length included, and the length bytes */
+/* of payload of packet, of CKSUM_* kind; the checksum field itself is   */
+/* left out                                                              */
+extern int pkt_checksum(const struct pkt *packet, int kind);
+
+/* the signed payload bytes added to sum, as CKSUM_SUM counts them */
+extern uint32_t cksum_bytesum(const void *buf, size_t len, uint32_t sum);
+
+/* one's complement sum of buf as 16-bit words in host byte order, */
+/* added to sum.  Pieces of a buffer can be summed one after the   */
+/* other as long as all but the last have even length; fold the    */
+/* total into the checksum with cksum_inet_fold                    */
+extern uint64_t cksum_inet_add(const void *buf, size_t len, uint64_t sum);
+extern uint16_t cksum_inet_fold(uint64_t sum);
+
+/* CRC-32C of buf continuing crc, which is 0 to start with */
+extern uint32_t cksum_crc32c(const void *buf, size_t len, uint32_t crc);
+
+/* the kernels behind cksum_inet_add and cksum_crc32c, for the      */
+/* benchmark; the vector ones may only run if cksum_cpu() says so   */
+#define CKSUM_CPU_AVX2   0x1
+#define CKSUM_CPU_SSE42  0x2
+extern int cksum_cpu(void);
+extern uint64_t cksum_inet_add_scalar(const void *buf, size_t len, uint64_t sum);
+extern uint64_t cksum_inet_add_avx2(const void *buf, size_t len, uint64_t sum);
+extern uint32_t cksum_crc32c_scalar(const void *buf, size_t len, uint32_t crc);
+extern uint32_t cksum_crc32c_sse42(const void *buf, size_t len, uint32_t crc);
+
+#endif
@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "checksum.h"
+
+/* ******************************************************************
+   Micro-benchmark of the checksum kernels of checksum.c: checks that
+   every kernel the CPU can run agrees with the scalar ones, then times
+   each on buffers from the size of the packet payload to a jumbo
+   frame, and the packet checksums of the protocols.
+
+   usage: cksumbench [megabytes]
+
+   Every kernel checksums about that many megabytes per buffer size,
+   64 by default.
+
+   Build:  gcc -O2 -o cksumbench cksumbench.c checksum.c -lpthread
+**********************************************************************/
+
+#define MAXSIZE 9000
+
+static const size_t sizes[] = { 20, 64, 256, 1500, 9000 };
+
+struct kernel {
+  const char *name;
+  int cpu;                 /* CKSUM_CPU_* it needs */
+  uint64_t (*run)(const void *buf, size_t len);
+};
+
+static uint64_t run_bytesum(const void *buf, size_t len)
+{
+  return cksum_bytesum(buf, len, 0);
+}
+
+static uint64_t run_inet_scalar(const void *buf, size_t len)
+{
+  return cksum_inet_fold(cksum_inet_add_scalar(buf, len, 0));
+}
+
+static uint64_t run_inet_avx2(const void *buf, size_t len)
+{
+  return cksum_inet_fold(cksum_inet_add_avx2(buf, len, 0));
+}
+
+static uint64_t run_crc32c_scalar(const void *buf, size_t len)
+{
+  return cksum_crc32c_scalar(buf, len, 0);
+}
+
+static uint64_t run_crc32c_sse42(const void *buf, size_t len)
+{
+  return cksum_crc32c_sse42(buf, len, 0);
+}
+
+static const struct kernel kernels[] = {
+  { "bytesum",       0,               run_bytesum },
+  { "inet scalar",   0,               run_inet_scalar },
+  { "inet avx2",     CKSUM_CPU_AVX2,  run_inet_avx2 },
+  { "crc32c scalar", 0,               run_crc32c_scalar },
+  { "crc32c sse4.2", CKSUM_CPU_SSE42, run_crc32c_sse42 },
+};
+#define NKERNELS ((int)(sizeof(kernels) / sizeof(kernels[0])))
+
+/* the checksum as the protocols computed it before checksum.c: the */
+/* packet is copied into the call                                  */
+__attribute__((noinline))
+static int bytevalue_checksum(struct pkt packet)
+{
+  unsigned int checksum = (unsigned int)packet.seqnum + packet.acknum + packet.flags + packet.length;
+  int i;
+
+  for (i = 0; i < 20; i++)
+    checksum += (int)(packet.payload[i]);
+  return (int)checksum;
+}
+
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int selftest(const unsigned char *buf, int cpu)
+{
+  /* the example of RFC 1071 and the check value of CRC-32C */
+  static const unsigned char rfc1071[8] = { 0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7 };
+  unsigned char out[2];
+  uint16_t inet;
+  size_t len, off;
+  int k, errors = 0;
+
+  inet = cksum_inet_fold(cksum_inet_add(rfc1071, sizeof(rfc1071), 0));
+  memcpy(out, &inet, 2);
+  if (out[0] != 0x22 || out[1] != 0x0d) {
+    printf("inet: RFC 1071 example gives %02x%02x, not 220d\n", out[0], out[1]);
+    errors++;
+  }
+  for (k = 0; k < NKERNELS; k++)
+    if (strncmp(kernels[k].name, "crc32c", 6) == 0 && (kernels[k].cpu & ~cpu) == 0 &&
+        kernels[k].run("123456789", 9) != 0xE3069283) {
+      printf("%s: check value %08llx, not e3069283\n", kernels[k].name,
+             (unsigned long long)kernels[k].run("123456789", 9));
+      errors++;
+    }
+  /* every length and alignment against the scalar kernels */
+  for (off = 0; off < 8; off++)
+    for (len = 0; len <= 600; len++) {
+      if ((cpu & CKSUM_CPU_AVX2) &&
+          run_inet_avx2(buf + off, len) != run_inet_scalar(buf + off, len)) {
+        printf("inet avx2: differs at offset %zu, length %zu\n", off, len);
+        errors++;
+      }
+      if ((cpu & CKSUM_CPU_SSE42) &&
+          run_crc32c_sse42(buf + off, len) != run_crc32c_scalar(buf + off, len)) {
+        printf("crc32c sse4.2: differs at offset %zu, length %zu\n", off, len);
+        errors++;
+      }
+      if (cksum_crc32c(buf + off + len / 3, len - len / 3, cksum_crc32c(buf + off, len / 3, 0)) !=
+          cksum_crc32c(buf + off, len, 0)) {
+        printf("crc32c: does not continue at offset %zu, length %zu\n", off, len);
+        errors++;
+      }
+    }
+  return errors;
+}
+
+/* ns per call of kernel k on len bytes, the fastest of three runs */
+static double timekernel(int k, const unsigned char *buf, size_t len, double megabytes)
+{
+  long n = (long)(megabytes * 1e6 / len), i;
+  volatile uint64_t sink = 0;
+  double t, best = 0.0;
+  int rep;
+
+  if (n < 1000)
+    n = 1000;
+  for (rep = 0; rep < 3; rep++) {
+    t = now();
+    for (i = 0; i < n; i++)
+      sink += kernels[k].run(buf, len);
+    t = now() - t;
+    if (rep == 0 || t < best)
+      best = t;
+  }
+  (void)sink;
+  return best / n * 1e9;
+}
+
+static void timepackets(double megabytes)
+{
+  static const struct { const char *name; int kind; } pk[] = {
+    { "sum", CKSUM_SUM }, { "inet", CKSUM_INET }, { "crc32c", CKSUM_CRC32C }
+  };
+  struct pkt packet;
+  long n = (long)(megabytes * 1e6 / sizeof(packet)), i;
+  volatile int sink = 0;
+  double t;
+  int k;
+
+  memset(&packet, 0, sizeof(packet));
+  packet.seqnum = 12345;
+  packet.acknum = 678;
+  packet.length = 20;
+  memcpy(packet.payload, "aaaaaaaaaaaaaaaaaaa", 20);
+  t = now();
+  for (i = 0; i < n; i++) {
+    packet.seqnum = (int)i;
+    sink += bytevalue_checksum(packet);
+  }
+  t = now() - t;
+  printf("%-22s %10.2f\n", "sum, packet by value", t / n * 1e9);
+  for (k = 0; k < (int)(sizeof(pk) / sizeof(pk[0])); k++) {
+    t = now();
+    for (i = 0; i < n; i++) {
+      packet.seqnum = (int)i;
+      sink += pkt_checksum(&packet, pk[k].kind);
+    }
+    t = now() - t;
+    printf("%-22s %10.2f\n", pk[k].name, t / n * 1e9);
+  }
+  (void)sink;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned char *buf;
+  double megabytes = 64.0, ns;
+  int cpu, k, i;
+
+  if (argc > 2 || (argc == 2 && (megabytes = strtod(argv[1], NULL)) <= 0.0)) {
+    fprintf(stderr, "usage: %s [megabytes]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  buf = malloc(MAXSIZE + 8);
+  if (buf == NULL) {
+    printf("memory allocation for the buffer failed.");
+    exit(EXIT_FAILURE);
+  }
+  srand(9999);
+  for (i = 0; i < MAXSIZE + 8; i++)
+    buf[i] = (unsigned char)rand();
+
+  cpu = cksum_cpu();
+  printf("CPU: avx2 %s, sse4.2 %s\n", (cpu & CKSUM_CPU_AVX2) ? "yes" : "no",
+         (cpu & CKSUM_CPU_SSE42) ? "yes" : "no");
+  if (selftest(buf, cpu) > 0) {
+    printf("self test failed\n");
+    return EXIT_FAILURE;
+  }
+  printf("self test passed\n\n");
+
+  printf("%-14s %6s %10s %8s\n", "kernel", "bytes", "ns/call", "GB/s");
+  for (k = 0; k < NKERNELS; k++)
+    for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+      if (kernels[k].cpu & ~cpu) {
+        printf("%-14s %6zu %10s %8s\n", kernels[k].name, sizes[i], "-", "-");
+        continue;
+      }
+      ns = timekernel(k, buf, sizes[i], megabytes);
+      printf("%-14s %6zu %10.2f %8.2f\n", kernels[k].name, sizes[i], ns, sizes[i] / ns);
+    }
+
+  printf("\n%-22s %10s\n", "packet checksum", "ns/call");
+  timepackets(megabytes);
+  free(buf);
+  return EXIT_SUCCESS;
+}
@@ -1,478 +1,1079 @@
-/* ***** THIS FILE SHOULD NOT BE MODIFIED ****************************
-   THERE IS NOT REASON THAT ANY STUDENT SHOULD HAVE TO READ OR UNDERSTAND
-   THE CODE BELOW.  YOU SHOLD NOT TOUCH, OR REFERENCE (in your code) ANY
-   OF THE DATA STRUCTURES BELOW.  If you're interested in how I designed
-   the emulator, you're welcome to look at the code - but again, you should have
-   to, and you defeinitely should not have to modify
-   This file contains the code that emulates the network.  It does not
-   implement any of the Go-Back-N protocol.
-   ********************************************************************
-
-   ******************************************************************
-   ALTERNATING BIT AND GO-BACK-N NETWORK EMULATOR: VERSION 1.1  J.F.Kurose
-   The code below emulates the layer 3 and below network environment:
-   - emulates the tranmission and delivery (possibly with bit-level corruption
-   and packet loss) of packets across the layer 3/4 interface
-   - handles the starting/stopping of a timer, and generates timer
-   interrupts (resulting in calling students timer handler).
-   - generates message to be sent (passed from later 5 to 4)
-
-   Network properties:
-   - one way network delay averages five time units (longer if there
-   are other messages in the channel for GBN), but can be larger
-   - packets can be corrupted (either the header or the data portion)
-   or lost, according to user-defined probabilities
-   - packets will be delivered in the order in which they were sent
-   (although some can be lost).
-
-   Modifications (6/6/2008 - CLP): 
-   - removed bidirectional GBN code and other code not used by prac. 
-   - removed hard coded maximum random number, use library defined
-   RAND_MAX value 
-   - simulator stops when no events are left rather than stopping as
-   soon as n packets are sent.
-   - fixed C style to adhere to current programming style
-
-   ********************************************************************* */
-#include <stdlib.h>
-#include <stdio.h>
-#include "emulator.h"
-#include "gbn.h"
-
-struct event {
-  float evtime;           /* event time */
-  int evtype;             /* event type code */
-  int eventity;           /* entity where event occurs */
-  struct pkt *pktptr;     /* ptr to packet (if any) assoc w/ this event */
-  struct event *prev;
-  struct event *next;
-};
-
-struct event *evlist = NULL;   /* the event list */
-
-/* possible events: */
-#define  TIMER_INTERRUPT 0  
-#define  FROM_LAYER5     1
-#define  FROM_LAYER3     2
-
-#define  OFF             0
-#define  ON              1
-
-int TRACE = 3;
-
-/* statistics updated by GBN */
-int window_full;   /* count of the number of messages dropped due to full window */
-int total_ACKs_received;
-int packets_resent;       /* count of the number of packets resent  */
-int new_ACKs;           /* count of the number of acks correctly received */
-int packets_received;  /* count of the packets received by receiver */
-
-/* statistics updated by emulator */
-static int packets_lost;  
-static int packets_corrupt;
-static int packets_sent;
-static int packets_timeout;
-static int messages_delivered;
-
-static int nsim = 0;              /* number of messages from 5 to 4 so far */ 
-static int nsimmax = 0;           /* number of msgs to generate, then stop */
-static float time = 0.000;
-static float lossprob;            /* probability that a packet is dropped  */
-static float corruptprob;   /* probability that one bit is packet is flipped */
-static int corruptdirection; /* A->B A<-B or bidirectional corruption/loss */
-static float lambda;        /* arrival rate of messages from layer 5 */   
-static int   ntolayer3;           /* number sent into layer 3 */
-static int   nlost;               /* number lost in media */
-static int ncorrupt;              /* number corrupted by media*/
-
-/****************************************************************************/
-/* jimsrand(): return a double in range [0,1].  The routine below is used to */
-/* isolate all random number generation in one location.  We assume that the*/
-/* system-supplied rand() function return an int in therange [0,mmm]        */
-/****************************************************************************/
-double jimsrand(void) 
-{
-  double mmm = RAND_MAX;     /* largest int  - MACHINE DEPENDENT!!!!!!!!   */
-  double x;                   
-  x = rand()/mmm;            /* x should be uniform in [0,1] */
-  if (TRACE > 3)
-    printf("RANDOM NUMBER GENERAION CALLED: %f\n", x);
-  return(x);
-}  
-
-/********************* EVENT HANDLINE ROUTINES *******/
-/*  The next set of routines handle the event list   */
-/*****************************************************/
-
-void insertevent(struct event *p)
-{
-  struct event *q,*qold;
-
-  if (TRACE>2) {
-    printf("            INSERTEVENT: time is %f\n",time);
-    printf("            INSERTEVENT: future time will be %f\n",p->evtime); 
-  }
-  q = evlist;     /* q points to front of list in which p struct inserted */
-  if (q==NULL) {   /* list is empty */
-    evlist=p;
-    p->next=NULL;
-    p->prev=NULL;
-  }
-  else {
-    for (qold = q; q !=NULL && p->evtime > q->evtime; q=q->next)
-      qold=q; 
-    if (q==NULL) {   /* end of list */
-      qold->next = p;
-      p->prev = qold;
-      p->next = NULL;
-    }
-    else if (q==evlist) { /* front of list */
-      p->next=evlist;
-      p->prev=NULL;
-      p->next->prev=p;
-      evlist = p;
-    }
-    else {     /* middle of list */
-      p->next=q;
-      p->prev=q->prev;
-      q->prev->next=p;
-      q->prev=p;
-    }
-  }
-}
-
-void generate_next_arrival(void)
-{
-  double x;
-  struct event *evptr;
-
-  if (TRACE>2)
-    printf("          GENERATE NEXT ARRIVAL: creating new arrival\n");
- 
-  x = lambda*jimsrand()*2;  /* x is uniform on [0,2*lambda] */
-  /* having mean of lambda        */
-  evptr = malloc(sizeof(struct event));
-  if (evptr == 0) {
-    printf("memory allocation for event failed.");
-    exit(EXIT_FAILURE);
-  }
-  evptr->evtime =  time + x;
-  evptr->evtype =  FROM_LAYER5;
-  if (BIDIRECTIONAL && (jimsrand()>0.5) )
-    evptr->eventity = B;
-  else
-    evptr->eventity = A;
-  insertevent(evptr);
-} 
-
-void printevlist(void)
-{
-  struct event *q;
-  printf("--------------\nEvent List Follows:\n");
-  for(q = evlist; q!=NULL; q=q->next) {
-    printf("Event time: %f, type: %d entity: %d\n",q->evtime,q->evtype,q->eventity);
-  }
-  printf("--------------\n");
-}
-
-void init(void)                         /* initialize the simulator */
-{
-  float sum, avg;
-  int i;
-
-  printf("-----  Stop and Wait Network Simulator Version 1.1 -------- \n\n");
-  printf("Enter the number of messages to simulate: ");
-  scanf("%d",&nsimmax);
-  printf("Enter  packet loss probability [enter 0.0 for no loss]:");
-  scanf("%f",&lossprob);
-  printf("Enter packet corruption probability [0.0 for no corruption]:");
-  scanf("%f",&corruptprob);
-  if (lossprob != 0.0 || corruptprob != 0.0) {
-    printf("If you want loss or corruption to only occur in one direction, choose the direction: 0 A->B, 1 A<-B, 2 A<->B (both directions) :");
-    scanf("%d",&corruptdirection);
-  }
-  printf("Enter average time between messages from sender's layer5 [ > 0.0]:");
-  scanf("%f",&lambda);
-  printf("Enter TRACE:");
-  scanf("%d",&TRACE);
-
-
-  srand(9999);              /* init random number generator */
-  sum = 0.0;                /* test random number generator for students */
-  for (i=0; i<1000; i++)
-    sum+=jimsrand();    /* jimsrand() should be uniform in [0,1] */
-  avg = sum/1000.0;
-  if (avg < 0.25 || avg > 0.75) {
-    printf("It is likely that random number generation on your machine\n" ); 
-    printf("is different from what this emulator expects.  Please take\n");
-    printf("a look at the routine jimsrand() in the emulator code. Sorry. \n");
-    exit(EXIT_FAILURE);
-  }
-
-  /* initialise statistics */
-  window_full = 0;
-  total_ACKs_received = 0;
-  packets_resent = 0;
-  new_ACKs = 0;
-  packets_received = 0;
-  packets_lost = 0;  
-  packets_corrupt = 0;
-  packets_sent = 0;
-  packets_timeout = 0;
-  messages_delivered = 0;
-
-  ntolayer3 = 0;
-  nlost = 0;
-  ncorrupt = 0;
-
-  time=0.0;                    /* initialize time to 0.0 */
-  generate_next_arrival();     /* initialize event list */
-}
-
-/********************** Student-callable ROUTINES ***********************/
-
-/* called by students routine to cancel a previously-started timer */
-void stoptimer(int AorB)
-/* A or B is trying to stop timer */
-{
-  struct event *q;
-
-  if (TRACE>1)
-    printf("          STOP TIMER: stopping timer at %f\n",time);
-  /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next)  */
-  for (q=evlist; q!=NULL ; q = q->next) 
-    if ( (q->evtype==TIMER_INTERRUPT  && q->eventity==AorB) ) { 
-      /* remove this event */
-      if (q->next==NULL && q->prev==NULL)
-        evlist=NULL;         /* remove first and only event on list */
-      else if (q->next==NULL) /* end of list - there is one in front */
-        q->prev->next = NULL;
-      else if (q==evlist) { /* front of list - there must be event after */
-        q->next->prev=NULL;
-        evlist = q->next;
-      }
-      else {     /* middle of list */
-        q->next->prev = q->prev;
-        q->prev->next =  q->next;
-      }
-      free(q);
-      return;
-    }
-  printf("Warning: unable to cancel your timer. It wasn't running.\n");
-}
-
-
-void starttimer(int AorB, double increment)
-/* A or B is trying to start timer */
-{
-
-  struct event *q;
-  struct event *evptr;
-
-  if (TRACE>1)
-    printf("          START TIMER: starting timer at %f\n",time);
-  /* be nice: check to see if timer is already started, if so, then  warn */
-  /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next)  */
-  for (q=evlist; q!=NULL ; q = q->next)  
-    if ( (q->evtype==TIMER_INTERRUPT  && q->eventity==AorB) ) { 
-      printf("Warning: attempt to start a timer that is already started\n");
-      return;
-    }
- 
-  /* create future event for when timer goes off */
-  evptr = malloc(sizeof(struct event));
-  if (evptr == 0) {
-    printf("memory allocation for event failed.");
-    exit(EXIT_FAILURE);
-  }
-  evptr->evtime =  time + increment;
-  evptr->evtype =  TIMER_INTERRUPT;
-   
- 
-  evptr->eventity = AorB;
-  insertevent(evptr);
-} 
-
-
-/************************** TOLAYER3 ***************/
-void tolayer3(int AorB, struct pkt packet)
-/* A or B is sending to network  */
-{
-  struct pkt *mypktptr;
-  struct event *evptr,*q;
-  float lastime, x;
-  int i;
-
-  ntolayer3++;
-
-  /* simulate losses: */
-  if (jimsrand() < lossprob && (!(AorB == B && corruptdirection == A) && !(AorB == A && corruptdirection == B))) {
-    nlost++;
-    if (TRACE>0)    
-      printf("          TOLAYER3: packet being lost\n");
-    return;
-  }  
-
-  /* make a copy of the packet student just gave me since he/she may decide */
-  /* to do something with the packet after we return back to him/her */ 
-  mypktptr = malloc(sizeof(struct pkt));
-  if (mypktptr == 0) {
-    printf("memory allocation for event failed.");
-    exit(EXIT_FAILURE);
-  }
-  mypktptr->seqnum = packet.seqnum;
-  mypktptr->acknum = packet.acknum;
-  mypktptr->checksum = packet.checksum;
-  for (i=0; i<20; i++)
-    mypktptr->payload[i] = packet.payload[i];
-  if (TRACE>2)  {
-    printf("          TOLAYER3: seq: %d, ack %d, check: %d ", mypktptr->seqnum,
-           mypktptr->acknum,  mypktptr->checksum);
-    for (i=0; i<20; i++)
-      printf("%c",mypktptr->payload[i]);
-    printf("\n");
-  }
-
-  /* create future event for arrival of packet at the other side */
-  evptr = malloc(sizeof(struct event));
-  if (evptr == 0) {
-    printf("memory allocation for event failed.");
-    exit(EXIT_FAILURE);
-  }
-  evptr->evtype =  FROM_LAYER3;   /* packet will pop out from layer3 */
-  evptr->eventity = (AorB+1) % 2; /* event occurs at other entity */
-  evptr->pktptr = mypktptr;       /* save ptr to my copy of packet */
-  /* finally, compute the arrival time of packet at the other end.
-     medium can not reorder, so make sure packet arrives between 1 and 10
-     time units after the latest arrival time of packets
-     currently in the medium on their way to the destination */
-  lastime = time;
-  /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next) */
-  for (q=evlist; q!=NULL ; q = q->next) 
-    if ( (q->evtype==FROM_LAYER3  && q->eventity==evptr->eventity) ) 
-      lastime = q->evtime;
-  evptr->evtime =  lastime + 1 + 9*jimsrand();
- 
-
-
-  /* simulate corruption: */
-  if ((jimsrand() < corruptprob)  && (!(AorB == B && corruptdirection == A) && !(AorB == A && corruptdirection == B))) {
-    ncorrupt++;
-    if ( (x = jimsrand()) < .75)
-      mypktptr->payload[0]='Z';   /* corrupt payload */
-    else if (x < .875)
-      mypktptr->seqnum = 999999;
-    else
-      mypktptr->acknum = 999999;
-    if (TRACE>0)    
-      printf("          TOLAYER3: packet being corrupted\n");
-  }  
-
-  if (TRACE>2)  
-    printf("          TOLAYER3: scheduling arrival on other side\n");
-  insertevent(evptr);
-} 
-
-void tolayer5(int AorB, char datasent[20])
-{
-  int i;  
-  if (TRACE>2) {
-    printf("          TOLAYER5: data received by application at ");
-    if (AorB == A) 
-      printf("A: ");
-    else
-      printf("B: ");
-    for (i=0; i<20; i++)  
-      printf("%c",datasent[i]);
-    printf("\n");
-  }
-  messages_delivered++;
-}
-
-int main(void)
-{
-  struct event *eventptr;
-  struct msg  msg2give;
-  struct pkt  pkt2give;
-   
-  int i,j;
-  
-  init();
-  A_init();
-  B_init();
-   
-  while (1) {
-    eventptr = evlist;            /* get next event to simulate */
-    if (eventptr==NULL)
-      goto terminate;
-    evlist = evlist->next;        /* remove this event from event list */
-    if (evlist!=NULL)
-      evlist->prev=NULL;
-    if (TRACE>=2) {
-      printf("\nEVENT time: %f,",eventptr->evtime);
-      printf("  type: %d",eventptr->evtype);
-      if (eventptr->evtype==0)
-        printf(", timerinterrupt  ");
-      else if (eventptr->evtype==1)
-        printf(", fromlayer5 ");
-      else
-        printf(", fromlayer3 ");
-      printf(" entity: %d\n",eventptr->eventity);
-    }
-    time = eventptr->evtime;        /* update time to next event time */
-    if (eventptr->evtype == FROM_LAYER5 ) {
-      if (nsim < nsimmax) {
-        generate_next_arrival();   /* set up future arrival */
-        /* fill in msg to give with string of same letter */    
-        j = nsim % 26; 
-        for (i=0; i<20; i++)  
-          msg2give.data[i] = 97 + j;
-        if (TRACE>2) {
-          printf("          MAINLOOP: data given to student: ");
-          for (i=0; i<20; i++) 
-            printf("%c", msg2give.data[i]);
-          printf("\n");
-        }
-        nsim++;
-        if (eventptr->eventity == A) 
-          A_output(msg2give);  
-        else
-          B_output(msg2give);  
-      }
-      else if (TRACE > 2)
-          printf("          FROM_LAYER5: no more messages to send: \n");
-    }
-    else if (eventptr->evtype ==  FROM_LAYER3) {
-      pkt2give.seqnum = eventptr->pktptr->seqnum;
-      pkt2give.acknum = eventptr->pktptr->acknum;
-      pkt2give.checksum = eventptr->pktptr->checksum;
-      for (i=0; i<20; i++)  
-        pkt2give.payload[i] = eventptr->pktptr->payload[i];
-	    if (eventptr->eventity ==A)      /* deliver packet by calling */
-        A_input(pkt2give);            /* appropriate entity */
-      else
-        B_input(pkt2give);
-	    free(eventptr->pktptr);          /* free the memory for packet */
-    }
-    else if (eventptr->evtype ==  TIMER_INTERRUPT) {
-      if (eventptr->eventity == A) 
-        A_timerinterrupt();
-      else
-        B_timerinterrupt();
-    }
-    else  {
-      printf("INTERNAL PANIC: unknown event type \n");
-    }
-    free(eventptr);
-  }
-
- terminate:
-  printf(" Simulator terminated at time %f\n after attempting to send %d msgs from layer5\n",time,nsim);
-  printf("number of messages dropped due to full window:  %d \n", window_full);
-  printf("number of valid (not corrupt or duplicate) acknowledgements received at A:  %d \n", new_ACKs);
-  printf("(note: a single acknowledgement may have acknowledged more than one packet - if cumulative acknowledgements are used)\n");
-  printf("number of packet resends by A:  %d \n", packets_resent);
-  printf("number of correct packets received at B:  %d \n", packets_received);
-  printf("number of messages delivered to application:  %d \n", messages_delivered);
-  return EXIT_SUCCESS;
+/* ***** THIS FILE SHOULD NOT BE MODIFIED ****************************
+   THERE IS NOT REASON THAT ANY STUDENT SHOULD HAVE TO READ OR UNDERSTAND
+   THE CODE BELOW.  YOU SHOLD NOT TOUCH, OR REFERENCE (in your code) ANY
+   OF THE DATA STRUCTURES BELOW.  If you're interested in how I designed
+   the emulator, you're welcome to look at the code - but again, you should have
+   to, and you defeinitely should not have to modify
+   This file contains the code that emulates the network.  It does not
+   implement any of the Go-Back-N protocol.
+   ********************************************************************
+
+   ******************************************************************
+   ALTERNATING BIT AND GO-BACK-N NETWORK EMULATOR: VERSION 1.1  J.F.Kurose
+   The code below emulates the layer 3 and below network environment:
+   - emulates the tranmission and delivery (possibly with bit-level corruption
+   and packet loss) of packets across the layer 3/4 interface
+   - handles the starting/stopping of a timer, and generates timer
+   interrupts (resulting in calling students timer handler).
+   - generates message to be sent (passed from later 5 to 4)
+
+   Network properties:
+   - one way network delay averages five time units (longer if there
+   are other messages in the channel for GBN), but can be larger
+   - packets can be corrupted (either the header or the data portion)
+   or lost, according to user-defined probabilities
+   - packets will be delivered in the order in which they were sent
+   (although some can be lost).
+
+   Modifications (6/6/2008 - CLP): 
+   - removed bidirectional GBN code and other code not used by prac. 
+   - removed hard coded maximum random number, use library defined
+   RAND_MAX value 
+   - simulator stops when no events are left rather than stopping as
+   soon as n packets are sent.
+   - fixed C style to adhere to current programming style
+
+   Modifications:
+   - the sorted event list is replaced by the schedulers in sched.c
+   (binary/4-ary heap, calendar queue or the original list).  The
+   default is SCHED_DEFAULT; set EMU_SCHED=list|heap|heap4|calendar
+   in the environment to choose one at run time.
+   - events come from a slab pool and carry their packet inline, so
+   the main loop does no malloc/free; everything is released at exit.
+   - each entity's pending timer is kept in timerevent[], so starting
+   and stopping a timer no longer searches the event list.  A stopped
+   timer is left in the schedule as a TIMER_CANCELLED tombstone and
+   discarded when it reaches the front.
+   - the FIFO guarantee of the medium uses the arrival time of the last
+   packet on each link (channel.h) instead of searching the event list.
+   - all state lives in a struct sim_ctx (sim.h) instead of file-scope
+   statics, with sim_create()/sim_run()/sim_destroy() so that many
+   simulations can run in one process.  The interactive front end that
+   reads a configuration from stdin is in main.c.
+   - random numbers come from the generators in rng.c, one per
+   simulation: RNG_COMPAT reproduces the rand() sequence of srand(9999)
+   exactly, RNG_XOSHIRO is a faster xoshiro256** with independent
+   streams.  Printing every draw at TRACE>3 now needs -DTRACE_RANDOM.
+   - the protocol is called through the struct transport_ops of the
+   simulation (transport.h), so GBN and SR link into one program and
+   are chosen at run time.
+   - TRACE output goes through trace records (trace.h): printed as
+   before, or appended to an mmap'ed binary ring when EMU_TRACEFILE is
+   set and printed later by tracedump.  -DEMU_TRACE=0 compiles the
+   trace sites out.
+   - every message A accepts is stamped on entry, and its delivery
+   latency goes into a histogram (hist.h).  sim_report() adds latency
+   percentiles, goodput, the retransmission ratio and the send window
+   occupancy, which the protocols report through sim_window().
+   - besides its one timer, each entity can run any number of logical
+   timers named by id (starttimer_id/stoptimer_id), kept in a
+   hierarchical timing wheel (wheel.h) and delivered to the protocol's
+   A_timeout/B_timeout.
+   - sim_time() gives the protocols the clock, so that the senders can
+   measure round trips for their adaptive timeouts (rto.h).
+   - a sender may queue the messages its full window cannot take
+   (sendq.h).  It reports the queue through sim_queue() and
+   sim_queuedelay(), and when it fills up through sim_backpressure(),
+   after which layer 5 holds its next message until the queue drains
+   if sim_config.backpressure is set.
+   - BIDIRECTIONAL is now proto_config.bidirectional, so B's layer 5
+   hands down messages at run time too, and packets carry flags
+   telling data and ACKs apart (PKT_DATA, PKT_ACK) so that an ACK can
+   ride on a data packet.
+   - packets cross the layer 3/4 boundary as refcounted buffers
+   (pktbuf.h) instead of being copied at every hop: tolayer3_buf()
+   puts the sender's buffer itself in the arrival event, and
+   A_input_buf()/B_input_buf() get it from there.  A sender resending
+   from its window passes another reference to the same buffer.  A
+   packet is only copied when it is corrupted while somebody else
+   still holds it.  tolayer3(), A_input() and B_input() keep taking
+   packets by value, copying them into or out of a buffer.
+   - messages and packets carry up to MAXPAYLOAD bytes, as many as
+   their length field says; the checksum covers that field.  Message
+   sizes follow sim_config.msgsize and msgdist, drawn from a generator
+   of their own.  Corruption flips one bit anywhere in the payload
+   rather than overwriting its first byte, and the statistics count
+   the bytes delivered and the header bytes sent besides the packets.
+   - each direction of the channel can be a bottleneck with a
+   bandwidth, a propagation delay and a finite drop-tail or RED queue
+   (sim_config.link, channel.h) instead of the random delay of 1 to 10
+   time units.  sim_report() then adds the utilization, queue length
+   and drops of each link.
+   - a link can lose packets in bursts (Gilbert-Elliott), reorder and
+   duplicate them.  A reordered packet may overtake a few packets in
+   flight, so the medium is no longer always FIFO; a duplicated one
+   goes through the channel twice.
+   - the senders can run a congestion window inside their flow control
+   window (proto_config.cc, cc.h) and report it through sim_cwnd();
+   sim_report() then adds its time average and the samples track it
+   with its threshold.
+
+   ********************************************************************* */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "emulator.h"
+#include "sim.h"
+#include "trace.h"
+#include "cc.h"
+
+/* possible events: */
+#define  TIMER_INTERRUPT 0  
+#define  FROM_LAYER5     1
+#define  FROM_LAYER3     2
+#define  TIMER_CANCELLED 3     /* stopped timer, skipped by the main loop */
+
+#define  OFF             0
+#define  ON              1
+
+_Thread_local int TRACE = 3;
+
+/* the simulation being created or run by this thread */
+static _Thread_local struct sim_ctx *cursim;
+
+/****************************************************************************/
+/* jimsrand(): return a double in range [0,1].  The routine below is used to */
+/* isolate all random number generation in one location.  We assume that the*/
+/* system-supplied rand() function return an int in therange [0,mmm]        */
+/* Each simulation now draws from its own generator, see rng.h.             */
+/****************************************************************************/
+double jimsrand(struct sim_ctx *sim) 
+{
+  double x;                   
+  x = rng_uniform(&sim->rng);   /* x should be uniform in [0,1] */
+#ifdef TRACE_RANDOM
+  if (TRACE > 3)
+    printf("RANDOM NUMBER GENERAION CALLED: %f\n", x);
+#endif
+  return(x);
+}  
+
+/********************* EVENT HANDLINE ROUTINES *******/
+/*  The next set of routines handle the event list   */
+/*****************************************************/
+
+void insertevent(struct sim_ctx *sim, struct event *p)
+{
+  TRACE_AT(2, TR_INSERTEVENT, p->eventity, 0, 0, 0, p->evtime, NULL, 0);
+  sched_insert(&sim->evlist, p);
+}
+
+void generate_next_arrival(struct sim_ctx *sim)
+{
+  double x;
+  struct event *evptr;
+
+  TRACE_LOG(2, TR_ARRIVAL, A, 0);
+ 
+  x = sim->cfg.lambda*jimsrand(sim)*2;  /* x is uniform on [0,2*lambda] */
+  /* having mean of lambda        */
+  evptr = evpool_get(&sim->evpool);
+  evptr->evtime =  sim->time + x;
+  evptr->evtype =  FROM_LAYER5;
+  if (sim->cfg.proto.bidirectional && (jimsrand(sim)>0.5) )
+    evptr->eventity = B;
+  else
+    evptr->eventity = A;
+  insertevent(sim, evptr);
+} 
+
+void printevlist(struct sim_ctx *sim)
+{
+  struct event *q;
+  printf("--------------\nEvent List Follows (%s):\n", sched_name(sim->evlist.kind));
+  for(q = sched_next(&sim->evlist, NULL); q!=NULL; q=sched_next(&sim->evlist, q)) {
+    printf("Event time: %f, type: %d entity: %d\n",q->evtime,q->evtype,q->eventity);
+  }
+  printf("--------------\n");
+}
+
+static const char *msgdist_names[] = { "fixed", "uniform", "exp", "imix" };
+
+int msgdist_byname(const char *name)
+{
+  int i;
+
+  for (i = 0; i < (int)(sizeof(msgdist_names) / sizeof(msgdist_names[0])); i++)
+    if (strcmp(name, msgdist_names[i]) == 0)
+      return i;
+  return -1;
+}
+
+const char *msgdist_name(int kind)
+{
+  if (kind < 0 || kind >= (int)(sizeof(msgdist_names) / sizeof(msgdist_names[0])))
+    return "unknown";
+  return msgdist_names[kind];
+}
+
+/* size of the next message from layer 5 */
+static int msg_length(struct sim_ctx *sim)
+{
+  double mean = sim->cfg.msgsize, u;
+  int len;
+
+  if (sim->cfg.msgdist == MSGDIST_FIXED)
+    return sim->cfg.msgsize;
+  u = rng_uniform(&sim->msgrng);
+  switch (sim->cfg.msgdist) {
+  case MSGDIST_UNIFORM:
+    len = 1 + (int)(u * (2 * mean - 1));
+    if (len > 2 * mean - 1)
+      len = (int)(2 * mean - 1);
+    break;
+  case MSGDIST_EXP:
+    len = u < 1.0 ? 1 + (int)(-(mean - 1) * log(1.0 - u)) : MAXPAYLOAD;
+    break;
+  default:
+    len = u < 7.0 / 12 ? 40 : u < 11.0 / 12 ? 576 : 1500;
+  }
+  if (len < 1)
+    len = 1;
+  return len < MAXPAYLOAD ? len : MAXPAYLOAD;
+}
+
+/********************** SIMULATION CONTEXTS ***********************/
+
+/* make sim the current simulation of this thread, return the previous one */
+static struct sim_ctx *sim_enter(struct sim_ctx *sim, int *savetrace)
+{
+  struct sim_ctx *prev = cursim;
+
+  *savetrace = TRACE;
+  cursim = sim;
+  TRACE = sim->cfg.trace;
+  return prev;
+}
+
+static void sim_leave(struct sim_ctx *prev, int savetrace)
+{
+  cursim = prev;
+  TRACE = savetrace;
+}
+
+void sim_defaults(struct sim_config *cfg)
+{
+  memset(cfg, 0, sizeof(struct sim_config));
+  cfg->transport = transports[0];
+  cfg->nsimmax = 1000;
+  cfg->corruptdirection = 2;
+  cfg->lambda = 10.0;
+  cfg->msgsize = MSGSIZE;
+  cfg->trace = 0;
+  cfg->sched = SCHED_DEFAULT;
+  cfg->rng = RNG_COMPAT;
+  cfg->seed = SIM_SEED;
+}
+
+struct sim_ctx *sim_create(const struct sim_config *cfg)  /* initialize the simulator */
+{
+  struct sim_ctx *sim, *prev;
+  float sum, avg;
+  int i, savetrace;
+
+  sim = calloc(1, sizeof(struct sim_ctx));
+  if (sim == NULL) {
+    printf("memory allocation for simulation failed.");
+    exit(EXIT_FAILURE);
+  }
+  sim->cfg = *cfg;
+  if (sim->cfg.transport == NULL)
+    sim->cfg.transport = transports[0];
+  if (sim->cfg.msgsize <= 0)
+    sim->cfg.msgsize = MSGSIZE;
+  if (sim->cfg.msgsize > MAXPAYLOAD) {
+    printf("Warning: message size %d too large, using %d\n", sim->cfg.msgsize, MAXPAYLOAD);
+    sim->cfg.msgsize = MAXPAYLOAD;
+  }
+  if (cfg->tracefile != NULL) {
+    sim->trace = malloc(sizeof(struct trace_ring));
+    if (sim->trace == NULL || trace_open(sim->trace, cfg->tracefile, cfg->tracesize) < 0) {
+      free(sim->trace);
+      free(sim);
+      return NULL;
+    }
+  }
+  prev = sim_enter(sim, &savetrace);
+
+  /* init random number generator */
+  rng_seed(&sim->rng, cfg->rng, cfg->seed, cfg->stream);
+  rng_seed(&sim->msgrng, cfg->rng, cfg->seed ^ 0x6d736773, cfg->stream);
+  sum = 0.0;                /* test random number generator for students */
+  for (i=0; i<1000; i++)
+    sum+=jimsrand(sim);    /* jimsrand() should be uniform in [0,1] */
+  avg = sum/1000.0;
+  if (avg < 0.25 || avg > 0.75) {
+    printf("It is likely that random number generation on your machine\n" ); 
+    printf("is different from what this emulator expects.  Please take\n");
+    printf("a look at the routine jimsrand() in the emulator code. Sorry. \n");
+    sim_leave(prev, savetrace);
+    if (sim->trace != NULL) {
+      trace_close(sim->trace);
+      free(sim->trace);
+    }
+    free(sim);
+    return NULL;
+  }
+
+  /* statistics start at zero (calloc) */
+  sched_init(&sim->evlist, cfg->sched);
+  evpool_init(&sim->evpool);
+  pktpool_init(&sim->pktpool);
+  wheel_init(&sim->timers);
+  link_init(&sim->links[A], A, B, &cfg->link[A]);
+  link_init(&sim->links[B], B, A, &cfg->link[B]);
+
+  sim->time=0.0;                    /* initialize time to 0.0 */
+  generate_next_arrival(sim);     /* initialize event list */
+
+  sim->cfg.transport->A_init();
+  sim->cfg.transport->B_init();
+  sim_leave(prev, savetrace);
+  return sim;
+}
+
+void sim_destroy(struct sim_ctx *sim)
+{
+  int i, j;
+
+  sched_destroy(&sim->evlist);      /* release the scheduler and every event */
+  evpool_destroy(&sim->evpool);
+  pktpool_destroy(&sim->pktpool);    /* with the packets still held */
+  link_destroy(&sim->links[A]);
+  link_destroy(&sim->links[B]);
+  if (sim->trace != NULL) {
+    trace_close(sim->trace);
+    free(sim->trace);
+  }
+  for (i = 0; i < 2; i++) {
+    for (j = 0; j < sim->nidtimer[i]; j++)
+      free(sim->idtimer[i][j]);
+    free(sim->idtimer[i]);
+  }
+  free(sim->stamps[A].t);
+  free(sim->stamps[B].t);
+  free(sim->samples);
+  free(sim->proto);
+  for (i = 0; i < sim->nblocks; i++)
+    free(sim->blocks[i]);
+  free(sim->blocks);
+  free(sim);
+}
+
+const struct proto_config *proto_config(void)
+{
+  return &cursim->cfg.proto;
+}
+
+struct sim_stats *sim_stats(void)
+{
+  return &cursim->stats;
+}
+
+double sim_time(void)
+{
+  return cursim->time;
+}
+
+void *sim_protostate(size_t size)
+{
+  struct sim_ctx *sim = cursim;
+
+  if (sim->proto == NULL) {
+    sim->proto = calloc(1, size);
+    if (sim->proto == NULL) {
+      printf("memory allocation for protocol state failed.");
+      exit(EXIT_FAILURE);
+    }
+  }
+  return sim->proto;
+}
+
+void *sim_alloc(size_t size)
+{
+  struct sim_ctx *sim = cursim;
+  void **grown;
+
+  if (sim->nblocks == sim->blocksize) {
+    sim->blocksize = sim->blocksize ? 2 * sim->blocksize : 16;
+    grown = realloc(sim->blocks, sim->blocksize * sizeof(void *));
+    if (grown == NULL) {
+      printf("memory allocation for protocol state failed.");
+      exit(EXIT_FAILURE);
+    }
+    sim->blocks = grown;
+  }
+  sim->blocks[sim->nblocks] = calloc(1, size);
+  if (sim->blocks[sim->nblocks] == NULL) {
+    printf("memory allocation for protocol state failed.");
+    exit(EXIT_FAILURE);
+  }
+  return sim->blocks[sim->nblocks++];
+}
+
+/********************** METRICS ***********************/
+
+static void *sim_grow(void *p, size_t size)
+{
+  p = realloc(p, size);
+  if (p == NULL) {
+    printf("memory allocation for statistics failed.");
+    exit(EXIT_FAILURE);
+  }
+  return p;
+}
+
+static void stamp_push(struct msgstamps *q, float t)
+{
+  int i;
+
+  if (q->count == q->size) {
+    /* unwrap into a ring twice the size */
+    q->t = sim_grow(q->t, (q->size ? 2 * q->size : 64) * sizeof(float));
+    for (i = 0; i < q->first; i++)
+      q->t[q->size + i] = q->t[i];
+    q->size = q->size ? 2 * q->size : 64;
+  }
+  q->t[(q->first + q->count++) & (q->size - 1)] = t;
+}
+
+static int stamp_pop(struct msgstamps *q, float *t)
+{
+  if (q->count == 0)
+    return 0;
+  *t = q->t[q->first];
+  q->first = (q->first + 1) & (q->size - 1);
+  q->count--;
+  return 1;
+}
+
+static void take_sample(struct sim_ctx *sim, float t)
+{
+  struct sim_sample *p;
+
+  if (sim->nsamples == sim->samplesize) {
+    sim->samplesize = sim->samplesize ? 2 * sim->samplesize : 256;
+    sim->samples = sim_grow(sim->samples, sim->samplesize * sizeof(struct sim_sample));
+  }
+  p = &sim->samples[sim->nsamples++];
+  p->time = t;
+  p->window = sim->window;
+  p->rto = sim->stats.rto;
+  p->delivered = sim->stats.messages_delivered;
+  p->queue = sim->queue;
+  p->linkq = link_depth(&sim->links[A], t);
+  p->cwnd = sim->stats.cwnd;
+  p->ssthresh = sim->stats.ssthresh;
+}
+
+/* take the samples due up to time t */
+static void sample_until(struct sim_ctx *sim, float t)
+{
+  while (sim->cfg.sampleinterval > 0 && t >= sim->nextsample) {
+    take_sample(sim, sim->nextsample);
+    sim->nextsample += sim->cfg.sampleinterval;
+  }
+}
+
+void sim_window(int entity, int npackets)
+{
+  struct sim_ctx *sim = cursim;
+
+  if (entity != A)
+    return;
+  sim->window_area += (double)sim->window * (sim->time - sim->window_since);
+  sim->window_since = sim->time;
+  sim->window = npackets;
+  if (npackets > sim->window_max)
+    sim->window_max = npackets;
+}
+
+void sim_cwnd(int entity, double cwnd)
+{
+  struct sim_ctx *sim = cursim;
+
+  if (entity != A)
+    return;
+  sim->cwnd_area += sim->cwnd * (sim->time - sim->cwnd_since);
+  sim->cwnd_since = sim->time;
+  sim->cwnd = cwnd;
+}
+
+void sim_queue(int entity, int nmsgs)
+{
+  struct sim_ctx *sim = cursim;
+
+  if (entity != A)
+    return;
+  sim->queue_area += (double)sim->queue * (sim->time - sim->queue_since);
+  sim->queue_since = sim->time;
+  sim->queue = nmsgs;
+  if (nmsgs > sim->queue_max)
+    sim->queue_max = nmsgs;
+}
+
+void sim_queuedelay(double t)
+{
+  hist_record(&cursim->queuedelay, t);
+}
+
+void sim_backpressure(int entity, int blocked)
+{
+  struct sim_ctx *sim = cursim;
+  struct event *evptr;
+
+  if (blocked) {
+    sim->stats.backpressured++;
+    sim->blocked[entity] = 1;
+    sim->blocked_since[entity] = sim->time;
+    return;
+  }
+  sim->blocked[entity] = 0;
+  sim->blocked_time += sim->time - sim->blocked_since[entity];
+  if (sim->held[entity]) {
+    /* hand the held message down now */
+    sim->held[entity] = 0;
+    evptr = evpool_get(&sim->evpool);
+    evptr->evtime = sim->time;
+    evptr->evtype = FROM_LAYER5;
+    evptr->eventity = entity;
+    insertevent(sim, evptr);
+  }
+}
+
+void sim_metrics(const struct sim_ctx *sim, struct sim_metrics *m)
+{
+  int accepted = sim->nsim - sim->stats.window_full;
+  int i;
+
+  memset(m, 0, sizeof(struct sim_metrics));
+  m->nlatency = sim->latency.count;
+  m->latency_mean = hist_mean(&sim->latency);
+  m->latency_p50 = hist_quantile(&sim->latency, 0.5);
+  m->latency_p99 = hist_quantile(&sim->latency, 0.99);
+  m->latency_p999 = hist_quantile(&sim->latency, 0.999);
+  m->latency_max = sim->latency.max;
+  if (sim->time > 0.0) {
+    m->goodput = sim->stats.messages_delivered / sim->time;
+    m->byte_goodput = sim->stats.bytes_delivered / sim->time;
+    m->window_mean = (sim->window_area +
+                      (double)sim->window * (sim->time - sim->window_since)) / sim->time;
+    m->queue_mean = (sim->queue_area +
+                     (double)sim->queue * (sim->time - sim->queue_since)) / sim->time;
+    m->cwnd_mean = (sim->cwnd_area + sim->cwnd * (sim->time - sim->cwnd_since)) / sim->time;
+  }
+  if (accepted > 0)
+    m->retransmit_ratio = (double)sim->stats.packets_resent / accepted;
+  if (sim->stats.bytes_tolayer3 > 0)
+    m->header_overhead = (double)sim->stats.header_tolayer3 / sim->stats.bytes_tolayer3;
+  if (sim->stats.packets_received > 0)
+    m->ack_ratio = (double)(sim->stats.acks_alone + sim->stats.acks_piggybacked) /
+                   sim->stats.packets_received;
+  m->window_max = sim->window_max;
+  m->queue_max = sim->queue_max;
+  m->nqueuedelay = sim->queuedelay.count;
+  m->queuedelay_mean = hist_mean(&sim->queuedelay);
+  m->queuedelay_p99 = hist_quantile(&sim->queuedelay, 0.99);
+  m->queuedelay_max = sim->queuedelay.max;
+  m->blocked_time = sim->blocked_time;
+  for (i = 0; i < 2; i++)
+    if (sim->blocked[i])
+      m->blocked_time += sim->time - sim->blocked_since[i];
+  if (sim->links[A].bursts + sim->links[B].bursts > 0)
+    m->loss_burst_mean = (double)(sim->links[A].lost + sim->links[B].lost) /
+                         (sim->links[A].bursts + sim->links[B].bursts);
+  for (i = 0; i < 2; i++)
+    if (link_rated(&sim->links[i])) {
+      m->link_util[i] = link_utilization(&sim->links[i], sim->time);
+      m->linkq_mean[i] = link_depth_mean(&sim->links[i], sim->time);
+      m->linkq_max[i] = sim->links[i].maxdepth;
+    }
+}
+
+void trace_emit(int type, int entity, int seq, int ack, int check,
+                float aux, const char *data, int len)
+{
+  struct sim_ctx *sim = cursim;
+  struct trace_rec rec;
+  int i;
+
+  rec.time = sim->time;
+  rec.aux = aux;
+  rec.seq = seq;
+  rec.ack = ack;
+  rec.check = check;
+  rec.type = type;
+  rec.entity = entity;
+  rec.flags = 0;
+  rec.data[0] = rec.data[1] = 0;
+  rec.len = 0;
+  if (data != NULL) {
+    rec.flags |= TRF_DATA;
+    rec.len = (uint16_t)len;
+    rec.data[0] = len > 0 ? data[0] : 0;
+    rec.data[1] = len > 1 ? data[1] : 0;
+    for (i=2; i<len; i++)
+      if (data[i] != data[1])
+        rec.flags |= TRF_MIXED;
+  }
+  if (sim->trace != NULL)
+    trace_put(sim->trace, &rec);
+  else
+    trace_render(stdout, &rec, data);
+}
+
+/********************** Student-callable ROUTINES ***********************/
+
+/* called by students routine to cancel a previously-started timer */
+void stoptimer(int AorB)
+/* A or B is trying to stop timer */
+{
+  struct sim_ctx *sim = cursim;
+  struct event *q;
+
+  TRACE_LOG(1, TR_STOPTIMER, AorB, 0);
+  q = sim->timerevent[AorB];
+  if (q == NULL) {
+    printf("Warning: unable to cancel your timer. It wasn't running.\n");
+    return;
+  }
+  /* leave a tombstone, the main loop drops it when it comes due */
+  q->evtype = TIMER_CANCELLED;
+  sim->timerevent[AorB] = NULL;
+}
+
+
+void starttimer(int AorB, double increment)
+/* A or B is trying to start timer */
+{
+  struct sim_ctx *sim = cursim;
+  struct event *evptr;
+
+  TRACE_LOG(1, TR_STARTTIMER, AorB, 0);
+  /* be nice: check to see if timer is already started, if so, then  warn */
+  if (sim->timerevent[AorB] != NULL) {
+    printf("Warning: attempt to start a timer that is already started\n");
+    return;
+  }
+ 
+  /* create future event for when timer goes off */
+  evptr = evpool_get(&sim->evpool);
+  evptr->evtime =  sim->time + increment;
+  evptr->evtype =  TIMER_INTERRUPT;
+   
+ 
+  evptr->eventity = AorB;
+  sim->timerevent[AorB] = evptr;
+  insertevent(sim, evptr);
+} 
+
+
+/* the logical timer id of entity AorB, created on first use */
+static struct wheel_timer *idtimer(struct sim_ctx *sim, int AorB, int id)
+{
+  struct wheel_timer **grown;
+  int n;
+
+  if (id >= sim->nidtimer[AorB]) {
+    for (n = sim->nidtimer[AorB] ? sim->nidtimer[AorB] : 16; n <= id; n *= 2)
+      ;
+    grown = realloc(sim->idtimer[AorB], n * sizeof(struct wheel_timer *));
+    if (grown == NULL) {
+      printf("memory allocation for timers failed.");
+      exit(EXIT_FAILURE);
+    }
+    memset(grown + sim->nidtimer[AorB], 0, (n - sim->nidtimer[AorB]) * sizeof(struct wheel_timer *));
+    sim->idtimer[AorB] = grown;
+    sim->nidtimer[AorB] = n;
+  }
+  if (sim->idtimer[AorB][id] == NULL) {
+    sim->idtimer[AorB][id] = calloc(1, sizeof(struct wheel_timer));
+    if (sim->idtimer[AorB][id] == NULL) {
+      printf("memory allocation for timers failed.");
+      exit(EXIT_FAILURE);
+    }
+    sim->idtimer[AorB][id]->entity = AorB;
+    sim->idtimer[AorB][id]->id = id;
+  }
+  return sim->idtimer[AorB][id];
+}
+
+void starttimer_id(int AorB, int id, double increment)
+{
+  struct sim_ctx *sim = cursim;
+  struct wheel_timer *t;
+
+  TRACE_LOG(1, TR_STARTTIMER, AorB, id);
+  if (id < 0) {
+    printf("Warning: timer id %d is negative, timer not started\n", id);
+    return;
+  }
+  t = idtimer(sim, AorB, id);
+  if (t->armed) {
+    printf("Warning: attempt to start a timer that is already started\n");
+    return;
+  }
+  /* expire when a timer event would: times are floats in the schedule */
+  wheel_add(&sim->timers, t, sim->time, (float)(sim->time + increment));
+}
+
+void stoptimer_id(int AorB, int id)
+{
+  struct sim_ctx *sim = cursim;
+
+  TRACE_LOG(1, TR_STOPTIMER, AorB, id);
+  if (id < 0 || id >= sim->nidtimer[AorB] || sim->idtimer[AorB][id] == NULL ||
+      !sim->idtimer[AorB][id]->armed) {
+    printf("Warning: unable to cancel your timer. It wasn't running.\n");
+    return;
+  }
+  wheel_del(&sim->timers, sim->idtimer[AorB][id]);
+}
+
+/************************** TOLAYER3 ***************/
+struct pkt *pkt_alloc(void)
+{
+  return pktpool_get(&cursim->pktpool);
+}
+
+const struct pkt *pkt_hold(const struct pkt *packet)
+{
+  pktpool_hold(packet);
+  return packet;
+}
+
+void pkt_release(const struct pkt *packet)
+{
+  pktpool_put(&cursim->pktpool, packet);
+}
+
+struct pkt *pkt_unshare(const struct pkt *packet)
+{
+  return pktpool_unshare(&cursim->pktpool, packet);
+}
+
+/* the by-value entry point: the packet goes into a buffer of its own */
+void tolayer3(int AorB, struct pkt packet)
+{
+  struct pkt *buf = pkt_alloc();
+
+  pkt_copy(buf, &packet);
+  tolayer3_buf(AorB, buf);
+}
+
+/* put packet on the link of AorB: queue, losses, arrival time and */
+/* corruption; the arrival event takes over the reference           */
+static void channel_send(struct sim_ctx *sim, int AorB, const struct pkt *packet)
+{
+  int corruptdirection = sim->cfg.corruptdirection;
+  struct link *link = &sim->links[AorB];
+  struct pkt *mypktptr;
+  struct event *evptr;
+  float lastime, x;
+  double arrival = 0.0;
+  int bit, lost, reordered;
+
+  /* a link with a bandwidth queues the packet first, or drops it */
+  if (link_rated(link)) {
+    switch (link_send(link, sim->time, PKT_HDRSIZE + packet->length, &sim->rng, &arrival)) {
+    case LINK_TAILDROP:
+      sim->stats.qdrops++;
+      TRACE_LOG(0, TR_QDROP, AorB, link_depth(link, sim->time));
+      pkt_release(packet);
+      return;
+    case LINK_REDDROP:
+      sim->stats.reddrops++;
+      TRACE_LOG(0, TR_REDDROP, AorB, link_depth(link, sim->time));
+      pkt_release(packet);
+      return;
+    }
+  }
+
+  /* simulate losses: */
+  if (link->cfg.loss == LOSS_GE)
+    lost = link_ge_lose(link, &sim->rng);
+  else
+    lost = jimsrand(sim) < sim->cfg.lossprob && (!(AorB == B && corruptdirection == A) && !(AorB == A && corruptdirection == B));
+  link_count_loss(link, lost);
+  if (lost) {
+    sim->stats.nlost++;
+    TRACE_LOG(0, TR_LOST, AorB, 0);
+    pkt_release(packet);
+    return;
+  }  
+
+  /* the arrival event takes over the sender's reference to the buffer; */
+  /* the sender only writes to it again through pkt_unshare()           */
+  evptr = evpool_get(&sim->evpool);
+  evptr->pkt = packet;
+  TRACE_AT(2, TR_TOLAYER3, AorB, packet->seqnum, packet->acknum,
+           packet->checksum, 0.0f, packet->payload, packet->length);
+
+  /* create future event for arrival of packet at the other side */
+  evptr->evtype =  FROM_LAYER3;   /* packet will pop out from layer3 */
+  evptr->eventity = (AorB+1) % 2; /* event occurs at other entity */
+  /* finally, compute the arrival time of packet at the other end.
+     medium can not reorder, so make sure packet arrives between 1 and 10
+     time units after the latest arrival time of packets
+     currently in the medium on their way to the destination.  The
+     queue of a link with a bandwidth has already decided it.  A
+     packet the link reorders only has to arrive after the packets
+     sent before the last few; on a link with a bandwidth it leaves
+     the queue at once. */
+  reordered = link_reorders(link, &sim->rng);
+  if (reordered) {
+    sim->stats.nreordered++;
+    TRACE_LOG(0, TR_REORDER, AorB, link->cfg.reorder_depth);
+  }
+  if (link_rated(link)) {
+    if (reordered) {
+      lastime = link_reorder_after(link, sim->time);
+      arrival = sim->time + link->cfg.propdelay;
+    }
+    else
+      lastime = link_lastarrival(link, sim->time);
+    /* strictly after: of events at the same time the later inserted   */
+    /* runs first, and on a fast link packets sent back to back leave  */
+    /* the queue closer together than event times, which are floats,   */
+    /* can tell apart                                                  */
+    if ((float)arrival <= lastime)
+      arrival = nextafterf(lastime, HUGE_VALF);
+    evptr->evtime = arrival;
+  }
+  else {
+    lastime = reordered ? link_reorder_after(link, sim->time) : link_lastarrival(link, sim->time);
+    evptr->evtime =  lastime + 1 + 9*jimsrand(sim);
+  }
+  link_schedule(link, evptr->evtime);
+ 
+
+
+  /* simulate corruption, on a copy if the sender still holds the buffer */
+  if ((jimsrand(sim) < sim->cfg.corruptprob)  && (!(AorB == B && corruptdirection == A) && !(AorB == A && corruptdirection == B))) {
+    sim->stats.ncorrupt++;
+    mypktptr = pkt_unshare(packet);
+    evptr->pkt = mypktptr;
+    if ( (x = jimsrand(sim)) < .75 && mypktptr->length > 0) {
+      /* corrupt payload: the same draw picks the bit */
+      bit = (int)(x / .75 * mypktptr->length * 8);
+      if (bit >= mypktptr->length * 8)
+        bit = mypktptr->length * 8 - 1;
+      mypktptr->payload[bit / 8] ^= (char)(1 << (bit % 8));
+    }
+    else if (x < .875)
+      mypktptr->seqnum = 999999;
+    else
+      mypktptr->acknum = 999999;
+    TRACE_LOG(0, TR_CORRUPT, AorB, 0);
+  }  
+
+  TRACE_LOG(2, TR_SCHEDULE, AorB, 0);
+  insertevent(sim, evptr);
+}
+
+void tolayer3_buf(int AorB, const struct pkt *packet)
+/* A or B is sending to network  */
+{
+  struct sim_ctx *sim = cursim;
+  struct link *link = &sim->links[AorB];
+
+  sim->stats.ntolayer3++;
+  sim->stats.bytes_tolayer3 += PKT_HDRSIZE + packet->length;
+  sim->stats.header_tolayer3 += PKT_HDRSIZE;
+
+  /* a duplicated packet goes through the channel twice, each copy */
+  /* lost, delayed and corrupted on its own                        */
+  if (link_duplicates(link, &sim->rng)) {
+    sim->stats.nduplicated++;
+    TRACE_LOG(0, TR_DUP, AorB, 0);
+    channel_send(sim, AorB, pkt_hold(packet));
+  }
+  channel_send(sim, AorB, packet);
+} 
+
+void tolayer5(int AorB, const char datasent[20])
+{
+  tolayer5_len(AorB, datasent, MSGSIZE);
+}
+
+void tolayer5_len(int AorB, const char *datasent, int length)
+{
+  float sent;
+
+  TRACE_AT(2, TR_TOLAYER5, AorB, 0, 0, 0, 0.0f, datasent, length);
+  cursim->stats.bytes_delivered += length;
+  /* messages are delivered in the order the other side accepted them */
+  if (stamp_pop(&cursim->stamps[!AorB], &sent))
+    hist_record(&cursim->latency, cursim->time - sent);
+  cursim->stats.messages_delivered++;
+}
+
+void sim_run(struct sim_ctx *sim)
+{
+  const struct transport_ops *ops = sim->cfg.transport;
+  struct sim_ctx *prev;
+  struct event *eventptr;
+  struct wheel_timer *timer;
+  struct msg  msg2give;
+   
+  int j,savetrace,full;
+  
+  prev = sim_enter(sim, &savetrace);
+   
+  while (1) {
+    /* logical timers due by the time of the next event go off first */
+    if (sim->timers.count > 0) {
+      eventptr = sched_peek(&sim->evlist);
+      timer = wheel_expire(&sim->timers, eventptr != NULL ? eventptr->evtime : HUGE_VAL);
+      if (timer != NULL) {
+        sample_until(sim, timer->expires);
+        TRACE_AT(1, TR_EVENT, timer->entity, TIMER_INTERRUPT, 0, 0, timer->expires, NULL, 0);
+        sim->time = timer->expires;
+        if (timer->entity == A && ops->A_timeout != NULL)
+          ops->A_timeout(timer->id);
+        else if (timer->entity == B && ops->B_timeout != NULL)
+          ops->B_timeout(timer->id);
+        else
+          printf("INTERNAL PANIC: no handler for timer %d\n", timer->id);
+        continue;
+      }
+    }
+    eventptr = sched_pop(&sim->evlist); /* get next event to simulate */
+    if (eventptr==NULL)
+      break;
+    if (eventptr->evtype == TIMER_CANCELLED) {
+      evpool_put(&sim->evpool, eventptr);
+      continue;
+    }
+    sample_until(sim, eventptr->evtime);
+    TRACE_AT(1, TR_EVENT, eventptr->eventity, eventptr->evtype, 0, 0,
+             eventptr->evtime, NULL, 0);
+    sim->time = eventptr->evtime;        /* update time to next event time */
+    if (eventptr->evtype == FROM_LAYER5 ) {
+      if (sim->nsim < sim->cfg.nsimmax && sim->cfg.backpressure &&
+          sim->blocked[eventptr->eventity]) {
+        sim->held[eventptr->eventity] = 1;   /* until the send queue drains */
+      }
+      else if (sim->nsim < sim->cfg.nsimmax) {
+        generate_next_arrival(sim);   /* set up future arrival */
+        /* fill in msg to give with string of same letter */    
+        j = sim->nsim % 26; 
+        msg2give.length = msg_length(sim);
+        memset(msg2give.data, 97 + j, msg2give.length);
+        TRACE_AT(2, TR_GIVEMSG, eventptr->eventity, 0, 0, 0, 0.0f, msg2give.data,
+                 msg2give.length);
+        sim->nsim++;
+        full = sim->stats.window_full;
+        if (eventptr->eventity == A) 
+          ops->A_output(msg2give);  
+        else
+          ops->B_output(msg2give);  
+        if (sim->stats.window_full == full)   /* accepted, stamp it */
+          stamp_push(&sim->stamps[eventptr->eventity], sim->time);
+      }
+      else
+        TRACE_LOG(2, TR_NOMORE, eventptr->eventity, 0);
+    }
+    else if (eventptr->evtype ==  FROM_LAYER3) {
+      /* lend the protocol the buffer, or a copy of the packet */
+      if (eventptr->eventity == A && ops->A_input_buf != NULL)
+        ops->A_input_buf(eventptr->pkt);
+      else if (eventptr->eventity == B && ops->B_input_buf != NULL)
+        ops->B_input_buf(eventptr->pkt);
+	    else if (eventptr->eventity ==A)      /* deliver packet by calling */
+        ops->A_input(*eventptr->pkt);       /* appropriate entity */
+      else
+        ops->B_input(*eventptr->pkt);
+      pkt_release(eventptr->pkt);
+    }
+    else if (eventptr->evtype ==  TIMER_INTERRUPT) {
+      sim->timerevent[eventptr->eventity] = NULL;
+      if (eventptr->eventity == A) 
+        ops->A_timerinterrupt();
+      else
+        ops->B_timerinterrupt();
+    }
+    else  {
+      printf("INTERNAL PANIC: unknown event type \n");
+    }
+    evpool_put(&sim->evpool, eventptr);
+  }
+
+  sim_leave(prev, savetrace);
+}
+
+void sim_report(const struct sim_ctx *sim)
+{
+  const struct sim_stats *st = &sim->stats;
+  const struct link *l;
+  struct sim_metrics m;
+  int i, rated, cc;
+
+  printf(" Simulator terminated at time %f\n after attempting to send %d msgs from layer5\n",sim->time,sim->nsim);
+  printf("number of messages dropped due to full window:  %d \n", st->window_full);
+  printf("number of valid (not corrupt or duplicate) acknowledgements received at A:  %d \n", st->new_ACKs);
+  printf("(note: a single acknowledgement may have acknowledged more than one packet - if cumulative acknowledgements are used)\n");
+  printf("number of packet resends by A:  %d \n", st->packets_resent);
+  printf("number of fast retransmits by A:  %d (%d packet resends, %d on timeouts) \n",
+         st->fast_retransmits, st->packets_fastresent,
+         st->packets_resent - st->packets_fastresent);
+  printf("number of packets selectively acknowledged (SACK) before the cumulative ACK:  %d \n",
+         st->packets_sacked);
+  printf("number of correct packets received at B:  %d \n", st->packets_received);
+  printf("number of ACKs sent on their own:  %d (%d by the delayed-ACK timer), on data packets:  %d \n",
+         st->acks_alone, st->acks_delayed, st->acks_piggybacked);
+  printf("number of messages delivered to application:  %d \n", st->messages_delivered);
+  printf("number of message bytes delivered to application:  %lld \n", st->bytes_delivered);
+  printf("number of bytes sent into layer 3:  %lld (%lld of them headers) \n",
+         st->bytes_tolayer3, st->header_tolayer3);
+
+  sim_metrics(sim, &m);
+  printf("delivery latency of %llu messages: mean %f p50 %f p99 %f p999 %f max %f\n",
+         m.nlatency, m.latency_mean, m.latency_p50, m.latency_p99, m.latency_p999, m.latency_max);
+  printf("goodput: %f messages per time unit\n", m.goodput);
+  printf("byte goodput: %f bytes per time unit, header overhead %f of the bytes sent\n",
+         m.byte_goodput, m.header_overhead);
+  printf("retransmission ratio: %f resends per message sent\n", m.retransmit_ratio);
+  printf("ACK ratio: %f ACKs sent per packet received\n", m.ack_ratio);
+  printf("send window occupancy: mean %f max %d packets\n", m.window_mean, m.window_max);
+  printf("send queue occupancy: mean %f max %d messages, full %d times for %f time units\n",
+         m.queue_mean, m.queue_max, st->backpressured, m.blocked_time);
+  printf("queueing delay of %llu messages: mean %f p99 %f max %f\n",
+         m.nqueuedelay, m.queuedelay_mean, m.queuedelay_p99, m.queuedelay_max);
+  printf("retransmission timeout%s: %f (srtt %f rttvar %f) after %d RTT samples, %d timeouts\n",
+         sim->cfg.proto.fixedrto ? " (fixed)" : "", st->rto, st->srtt, st->rttvar,
+         st->rtt_samples, st->timeouts);
+  if (sim->cfg.proto.cc != CC_NONE)
+    printf("congestion window (%s): mean %f, %f (ssthresh %f) at the end, cut %d times\n",
+           cc_name(sim->cfg.proto.cc), m.cwnd_mean, st->cwnd, st->ssthresh,
+           st->cwnd_reductions);
+  for (i = 0; i < 2; i++) {
+    l = &sim->links[i];
+    if (link_rated(l))
+      printf("link %c->%c: %d packets sent, utilization %f, queue mean %f max %d packets, "
+             "%d dropped full, %d dropped by RED (%s)\n",
+             "AB"[l->src], "AB"[l->dst], l->sent, m.link_util[i], m.linkq_mean[i],
+             m.linkq_max[i], l->taildrops, l->reddrops, link_aqm_name(l->cfg.aqm));
+    if (link_impaired(l))
+      printf("link %c->%c: %d packets lost in %d bursts (%s), %d reordered, %d duplicated\n",
+             "AB"[l->src], "AB"[l->dst], l->lost, l->bursts, link_loss_name(l->cfg.loss),
+             l->reordered, l->duplicated);
+  }
+  if (sim->nsamples > 0) {
+    rated = link_rated(&sim->links[A]);
+    cc = sim->cfg.proto.cc != CC_NONE;
+    printf("time, packets in send window, messages delivered, timeout, messages queued%s%s:\n",
+           rated ? ", packets in the A->B link queue" : "",
+           cc ? ", congestion window, ssthresh" : "");
+    for (i = 0; i < sim->nsamples; i++) {
+      printf("%f %d %d %f %d", sim->samples[i].time, sim->samples[i].window,
+             sim->samples[i].delivered, sim->samples[i].rto, sim->samples[i].queue);
+      if (rated)
+        printf(" %d", sim->samples[i].linkq);
+      if (cc)
+        printf(" %f %f", sim->samples[i].cwnd, sim->samples[i].ssthresh);
+      printf("\n");
+    }
+  }
 }
\ No newline at end of file
@@ -1,40 +1,191 @@
-extern int TRACE;
-
-/* statistics updated by GBN */
-extern int total_ACKs_received;
-extern int packets_resent;       /* count of the number of packets resent  */
-extern int new_ACKs;      /* count of the number of acks correctly received */
-extern int packets_received;  /* count of the packets received by receiver */
-extern int window_full; /* count of the number of messages dropped due to full window */
-
-#define   A    0
-#define   B    1
-
-/* a "msg" is the data unit passed from layer 5 (teachers code) to layer  */
-/* 4 (students' code).  It contains the data (characters) to be delivered */
-/* to layer 5 via the students transport level protocol entities.         */
-struct msg {
-  char data[20];
-};
-
-/* a packet is the data unit passed from layer 4 (students code) to layer */
-/* 3 (teachers code).  Note the pre-defined packet structure, which all   */
-/* students must follow. */
-struct pkt {
-  int seqnum;
-  int acknum;
-  int checksum;
-  char payload[20];
-};
-
-/* send to A or B (int), packet to send */
-extern void tolayer3(int, struct pkt);  
-
-/* deliver to A or B (int), data to deliver */
-extern void tolayer5(int, char[20]); 
-
-/* start timer at A or B (int), increment */
-extern void starttimer(int, double);       
-
-/* stop timer at A or B (int) */
-extern void stoptimer(int);               
+#ifndef EMULATOR_H
+#define EMULATOR_H
+
+#include <stddef.h>
+
+/* trace level of the simulation running on this thread */
+extern _Thread_local int TRACE;
+
+/* statistics of one simulation */
+struct sim_stats {
+  /* updated by the protocol, for both directions of a bidirectional run */
+  int total_ACKs_received;
+  int packets_resent;       /* count of the number of packets resent  */
+  int new_ACKs;      /* count of the number of acks correctly received */
+  int packets_received;  /* count of the packets received by receiver */
+  int window_full; /* count of the number of messages dropped due to full window */
+  int fast_retransmits;    /* window resends on duplicate ACKs */
+  int packets_fastresent;  /* packets they resent, also in packets_resent */
+  int backpressured;       /* times the send queue filled up */
+  int acks_piggybacked;    /* ACKs that rode on a data packet */
+  int acks_alone;          /* packets sent only to carry an ACK */
+  int acks_delayed;        /* of those, sent by the delayed-ACK timer */
+  int packets_sacked;      /* packets a SACK reported before the */
+                           /* cumulative ACK covered them        */
+
+  /* A's retransmission timeout (rto.h) */
+  int rtt_samples;         /* round trips measured */
+  int timeouts;            /* retransmission timer expiries */
+  float srtt, rttvar;      /* estimator at the end of the run */
+  float rto;               /* timeout at the end of the run */
+
+  /* A's congestion window (cc.h) */
+  float cwnd, ssthresh;    /* at the end of the run, in packets */
+  int cwnd_reductions;     /* times a loss cut it down */
+
+  /* updated by emulator */
+  int messages_delivered;  /* messages passed up to layer 5 */
+  int ntolayer3;           /* number sent into layer 3 */
+  int nlost;               /* number lost in media */
+  int ncorrupt;            /* number corrupted by media*/
+  int qdrops;              /* number dropped by a full link queue */
+  int reddrops;            /* number dropped early by RED */
+  int nreordered;          /* number allowed to overtake others */
+  int nduplicated;         /* number sent twice by media */
+  long long bytes_tolayer3; /* header and payload bytes sent into layer 3 */
+  long long header_tolayer3; /* of those, header bytes */
+  long long bytes_delivered; /* message bytes passed up to layer 5 */
+};
+
+/* protocol parameters of one simulation; zero means the protocol's */
+/* own default */
+struct proto_config {
+  int windowsize;          /* sender window, in packets */
+  int fixedrto;            /* time out after the constant RTT, as the */
+                           /* assignment requires, instead of adapting */
+  int dupacks;             /* duplicate ACKs that trigger a fast */
+                           /* retransmit, negative for none        */
+  int sendqueue;           /* messages queued while the window is */
+                           /* full (sendq.h), 0 for none           */
+  int bidirectional;       /* B sends messages too, and ACKs ride on */
+                           /* the data packets going the other way   */
+  float ackdelay;          /* how long a receiver holds the ACK of   */
+                           /* data back, for data going the other way */
+                           /* or more packets to share it; negative   */
+                           /* for not at all, and by default only in  */
+                           /* bidirectional runs or with ackevery     */
+  int ackevery;            /* a delayed ACK is sent at the latest    */
+                           /* after this many packets, negative for  */
+                           /* no limit; out of order data is always  */
+                           /* ACKed at once                          */
+  int sack;                /* receivers buffer out of order data and */
+                           /* report it in selective ACKs (sack.h),  */
+                           /* senders resend only the holes          */
+  int checksum;            /* CKSUM_* kind of packet checksum        */
+                           /* (checksum.h)                           */
+  int cc;                  /* CC_* congestion control of the senders */
+                           /* (cc.h), CC_NONE for the fixed window   */
+};
+
+/* protocol parameters of the simulation running on this thread */
+extern const struct proto_config *proto_config(void);
+
+/* statistics of the simulation running on this thread */
+extern struct sim_stats *sim_stats(void);
+
+/* current time of the simulation running on this thread */
+extern double sim_time(void);
+
+/* a sender reports the number of packets in its send window whenever */
+/* that changes; the window occupancy statistics follow A's            */
+extern void sim_window(int entity, int npackets);
+
+/* likewise its congestion window (cc.h), in packets */
+extern void sim_cwnd(int entity, double cwnd);
+
+/* a sender reports the number of messages in its send queue whenever */
+/* that changes (the statistics follow A's), and how long each message */
+/* waited when it leaves                                               */
+extern void sim_queue(int entity, int nmsgs);
+extern void sim_queuedelay(double t);
+
+/* backpressure callback of the send queues: layer 5 of entity holds */
+/* back its messages while blocked, if the simulation is configured   */
+/* to (sim_config.backpressure)                                       */
+extern void sim_backpressure(int entity, int blocked);
+
+/* protocol state of the simulation running on this thread: size bytes, */
+/* zero filled by the first call and freed with the simulation          */
+extern void *sim_protostate(size_t size);
+
+/* size bytes of zero filled memory, freed with the simulation running */
+/* on this thread: for protocol state sized at run time               */
+extern void *sim_alloc(size_t size);
+
+#define   A    0
+#define   B    1
+
+#define MSGSIZE    20       /* bytes in a message of the assignment */
+#define MAXPAYLOAD 9000     /* largest message and packet payload, a */
+                            /* jumbo frame                            */
+
+/* a "msg" is the data unit passed from layer 5 (teachers code) to layer  */
+/* 4 (students' code).  It contains the data (characters) to be delivered */
+/* to layer 5 via the students transport level protocol entities.         */
+/* Messages vary in length now (sim_config.msgsize and msgdist).          */
+struct msg {
+  int length;               /* bytes of data used */
+  char data[MAXPAYLOAD];
+};
+
+/* a packet is the data unit passed from layer 4 (students code) to layer */
+/* 3 (teachers code).  Note the pre-defined packet structure, which all   */
+/* students must follow.  The payload comes last, so that copies and the */
+/* checksum only need the header and the length bytes in use.            */
+struct pkt {
+  int seqnum;
+  int acknum;
+  int checksum;
+  int flags;                /* PKT_* below: what the packet carries */
+  int length;               /* bytes of payload used, covered by the */
+                            /* checksum                               */
+  char payload[MAXPAYLOAD];
+};
+
+/* bytes of the packet header on the wire, the fields before the payload */
+#define PKT_HDRSIZE ((int)offsetof(struct pkt, payload))
+
+#define PKT_DATA  0x1       /* seqnum and payload hold a message */
+#define PKT_ACK   0x2       /* acknum acknowledges data */
+#define PKT_CUMACK 0x4      /* and everything before it, for protocols */
+                            /* whose ACKs are not cumulative anyway     */
+#define PKT_SACK  0x8       /* the payload holds a selective ACK (sack.h) */
+
+/* bidirectional communication is chosen at run time now, see */
+/* proto_config.bidirectional                                 */
+
+/* send to A or B (int), packet to send */
+extern void tolayer3(int, struct pkt);  
+
+/* refcounted packet buffers (pktbuf.h), passed without copying: */
+/* tolayer3_buf() takes over one reference of the caller, which   */
+/* passes pkt_hold(packet) to keep the packet for resending.  A   */
+/* buffer may only be written through pkt_unshare()                */
+extern struct pkt *pkt_alloc(void);
+extern const struct pkt *pkt_hold(const struct pkt *packet);
+extern void pkt_release(const struct pkt *packet);
+extern struct pkt *pkt_unshare(const struct pkt *packet);
+extern void tolayer3_buf(int, const struct pkt *);
+
+/* copy the header of src and the bytes of its payload in use */
+extern void pkt_copy(struct pkt *dst, const struct pkt *src);
+
+/* deliver to A or B (int), data to deliver, of MSGSIZE bytes */
+extern void tolayer5(int, const char[20]); 
+
+/* the same for data of any length (int) */
+extern void tolayer5_len(int, const char *, int);
+
+/* start timer at A or B (int), increment */
+extern void starttimer(int, double);       
+
+/* stop timer at A or B (int) */
+extern void stoptimer(int);               
+
+/* logical timers: A or B (int) may run any number of them besides the */
+/* one above, told apart by an id >= 0 of its choosing.  When one goes */
+/* off the protocol's A_timeout(id) or B_timeout(id) is called.        */
+extern void starttimer_id(int, int, double);
+extern void stoptimer_id(int, int);
+
+#endif
@@ -1,275 +1,806 @@
-#include <stdlib.h>
-#include <stdio.h>
-#include <stdbool.h>
-#include "emulator.h"
-#include "gbn.h"
-
-/* ******************************************************************
-   Go Back N protocol.  Adapted from J.F.Kurose
-   ALTERNATING BIT AND GO-BACK-N NETWORK EMULATOR: VERSION 1.2
-
-   Network properties:
-   - one way network delay averages five time units (longer if there
-   are other messages in the channel for GBN), but can be larger
-   - packets can be corrupted (either the header or the data portion)
-   or lost, according to user-defined probabilities
-   - packets will be delivered in the order in which they were sent
-   (although some can be lost).
-
-   Modifications:
-   - removed bidirectional GBN code and other code not used by prac.
-   - fixed C style to adhere to current programming style
-   - added GBN implementation
-**********************************************************************/
-
-#define RTT  16.0       /* round trip time.  MUST BE SET TO 16.0 when submitting assignment */
-#define WINDOWSIZE 6    /* the maximum number of buffered unacked packet
-                          MUST BE SET TO 6 when submitting assignment */
-#define SEQSPACE 7      /* the min sequence space for GBN must be at least windowsize + 1 */
-#define NOTINUSE (-1)   /* used to fill header fields that are not being used */
-
-/* generic procedure to compute the checksum of a packet.  Used by both sender and receiver
-   the simulator will overwrite part of your packet with 'z's.  It will not overwrite your
-   original checksum.  This procedure must generate a different checksum to the original if
-   the packet is corrupted.
-*/
-int ComputeChecksum(struct pkt packet)
-{
-  int checksum = 0;
-  int i;
-
-  checksum = packet.seqnum;
-  checksum += packet.acknum;
-  for ( i=0; i<20; i++ )
-    checksum += (int)(packet.payload[i]);
-
-  return checksum;
-}
-
-bool IsCorrupted(struct pkt packet)
-{
-  if (packet.checksum == ComputeChecksum(packet))
-    return (false);
-  else
-    return (true);
-}
-
-
-/********* Sender (A) variables and functions ************/
-
-static struct pkt buffer[WINDOWSIZE];  /* array for storing packets waiting for ACK */
-static int windowfirst, windowlast;    /* array indexes of the first/last packet awaiting ACK */
-static int windowcount;                /* the number of packets currently awaiting an ACK */
-static int A_nextseqnum;               /* the next sequence number to be used by the sender */
-
-/* called from layer 5 (application layer), passed the message to be sent to other side */
-void A_output(struct msg message)
-{
-  struct pkt sendpkt;
-  int i;
-
-  /* if not blocked waiting on ACK */
-  if ( windowcount < WINDOWSIZE) {
-    if (TRACE > 1)
-      printf("----A: New message arrives, send window is not full, send new messge to layer3!\n");
-
-    /* create packet */
-    sendpkt.seqnum = A_nextseqnum;
-    sendpkt.acknum = NOTINUSE;
-    for ( i=0; i<20 ; i++ )
-      sendpkt.payload[i] = message.data[i];
-    sendpkt.checksum = ComputeChecksum(sendpkt);
-
-    /* put packet in window buffer */
-    /* windowlast will always be 0 for alternating bit; but not for GoBackN */
-    windowlast = (windowlast + 1) % WINDOWSIZE;
-    buffer[windowlast] = sendpkt;
-    windowcount++;
-
-    /* send out packet */
-    if (TRACE > 0)
-      printf("Sending packet %d to layer 3\n", sendpkt.seqnum);
-    tolayer3 (A, sendpkt);
-
-    /* start timer if first packet in window */
-    if (windowcount == 1)
-      starttimer(A,RTT);
-
-    /* get next sequence number, wrap back to 0 */
-    A_nextseqnum = (A_nextseqnum + 1) % SEQSPACE;
-  }
-  /* if blocked,  window is full */
-  else {
-    if (TRACE > 0)
-      printf("----A: New message arrives, send window is full\n");
-    window_full++;
-  }
-}
-
-
-/* called from layer 3, when a packet arrives for layer 4
-   In this practical this will always be an ACK as B never sends data.
-*/
-void A_input(struct pkt packet)
-{
-  int ackcount = 0;
-  int i;
-
-  /* if received ACK is not corrupted */
-  if (!IsCorrupted(packet)) {
-    if (TRACE > 0)
-      printf("----A: uncorrupted ACK %d is received\n",packet.acknum);
-    total_ACKs_received++;
-
-    /* check if new ACK or duplicate */
-    if (windowcount != 0) {
-          int seqfirst = buffer[windowfirst].seqnum;
-          int seqlast = buffer[windowlast].seqnum;
-          /* check case when seqnum has and hasn't wrapped */
-          if (((seqfirst <= seqlast) && (packet.acknum >= seqfirst && packet.acknum <= seqlast)) ||
-              ((seqfirst > seqlast) && (packet.acknum >= seqfirst || packet.acknum <= seqlast))) {
-
-            /* packet is a new ACK */
-            if (TRACE > 0)
-              printf("----A: ACK %d is not a duplicate\n",packet.acknum);
-            new_ACKs++;
-
-            /* cumulative acknowledgement - determine how many packets are ACKed */
-            if (packet.acknum >= seqfirst)
-              ackcount = packet.acknum + 1 - seqfirst;
-            else
-              ackcount = SEQSPACE - seqfirst + packet.acknum;
-
-	    /* slide window by the number of packets ACKed */
-            windowfirst = (windowfirst + ackcount) % WINDOWSIZE;
-
-            /* delete the acked packets from window buffer */
-            for (i=0; i<ackcount; i++)
-              windowcount--;
-
-	    /* start timer again if there are still more unacked packets in window */
-            stoptimer(A);
-            if (windowcount > 0)
-              starttimer(A, RTT);
-
-          }
-        }
-        else
-          if (TRACE > 0)
-        printf ("----A: duplicate ACK received, do nothing!\n");
-  }
-  else
-    if (TRACE > 0)
-      printf ("----A: corrupted ACK is received, do nothing!\n");
-}
-
-/* called when A's timer goes off */
-void A_timerinterrupt(void)
-{
-  int i;
-
-  if (TRACE > 0)
-    printf("----A: time out,resend packets!\n");
-
-  for(i=0; i<windowcount; i++) {
-
-    if (TRACE > 0)
-      printf ("---A: resending packet %d\n", (buffer[(windowfirst+i) % WINDOWSIZE]).seqnum);
-
-    tolayer3(A,buffer[(windowfirst+i) % WINDOWSIZE]);
-    packets_resent++;
-    if (i==0) starttimer(A,RTT);
-  }
-}
-
-
-
-/* the following routine will be called once (only) before any other */
-/* entity A routines are called. You can use it to do any initialization */
-void A_init(void)
-{
-  /* initialise A's window, buffer and sequence number */
-  A_nextseqnum = 0;  /* A starts with seq num 0, do not change this */
-  windowfirst = 0;
-  windowlast = -1;   /* windowlast is where the last packet sent is stored.
-		     new packets are placed in winlast + 1
-		     so initially this is set to -1
-		   */
-  windowcount = 0;
-}
-
-
-
-/********* Receiver (B)  variables and procedures ************/
-
-static int expectedseqnum; /* the sequence number expected next by the receiver */
-static int B_nextseqnum;   /* the sequence number for the next packets sent by B */
-
-
-/* called from layer 3, when a packet arrives for layer 4 at B*/
-void B_input(struct pkt packet)
-{
-  struct pkt sendpkt;
-  int i;
-
-  /* if not corrupted and received packet is in order */
-  if  ( (!IsCorrupted(packet))  && (packet.seqnum == expectedseqnum) ) {
-    if (TRACE > 0)
-      printf("----B: packet %d is correctly received, send ACK!\n",packet.seqnum);
-    packets_received++;
-
-    /* deliver to receiving application */
-    tolayer5(B, packet.payload);
-
-    /* send an ACK for the received packet */
-    sendpkt.acknum = expectedseqnum;
-
-    /* update state variables */
-    expectedseqnum = (expectedseqnum + 1) % SEQSPACE;
-  }
-  else {
-    /* packet is corrupted or out of order resend last ACK */
-    if (TRACE > 0)
-      printf("----B: packet corrupted or not expected sequence number, resend ACK!\n");
-    if (expectedseqnum == 0)
-      sendpkt.acknum = SEQSPACE - 1;
-    else
-      sendpkt.acknum = expectedseqnum - 1;
-  }
-
-  /* create packet */
-  sendpkt.seqnum = B_nextseqnum;
-  B_nextseqnum = (B_nextseqnum + 1) % 2;
-
-  /* we don't have any data to send.  fill payload with 0's */
-  for ( i=0; i<20 ; i++ )
-    sendpkt.payload[i] = '0';
-
-  /* computer checksum */
-  sendpkt.checksum = ComputeChecksum(sendpkt);
-
-  /* send out packet */
-  tolayer3 (B, sendpkt);
-}
-
-/* the following routine will be called once (only) before any other */
-/* entity B routines are called. You can use it to do any initialization */
-void B_init(void)
-{
-  expectedseqnum = 0;
-  B_nextseqnum = 1;
-}
-
-/******************************************************************************
- * The following functions need be completed only for bi-directional messages *
- *****************************************************************************/
-
-/* Note that with simplex transfer from a-to-B, there is no B_output() */
-void B_output(struct msg message)
-{
-}
-
-/* called when B's timer goes off */
-void B_timerinterrupt(void)
-{
-}
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include "emulator.h"
+#include "gbn.h"
+#include "trace.h"
+#include "rto.h"
+#include "cc.h"
+#include "sendq.h"
+#include "seqnum.h"
+#include "sack.h"
+#include "checksum.h"
+
+/* ******************************************************************
+   Go Back N protocol.  Adapted from J.F.Kurose
+   ALTERNATING BIT AND GO-BACK-N NETWORK EMULATOR: VERSION 1.2
+
+   Network properties:
+   - one way network delay averages five time units (longer if there
+   are other messages in the channel for GBN), but can be larger
+   - packets can be corrupted (either the header or the data portion)
+   or lost, according to user-defined probabilities
+   - packets will be delivered in the order in which they were sent
+   (although some can be lost).
+
+   Modifications:
+   - removed bidirectional GBN code and other code not used by prac.
+   - fixed C style to adhere to current programming style
+   - added GBN implementation
+  - fast retransmit: DUPACKS duplicates of the ACK before the window
+  mean its first packet was lost, so the window is resent at once
+  instead of when the timer goes off.  Copies of packets B already
+  has are re-ACKed too, so after a resend duplicates only count
+  again once a packet sent after it is ACKed; the channel is FIFO,
+  so by then every copy has been ACKed
+  - messages that arrive while the window is full wait in a send
+  queue (sendq.h), if one is configured, and are sent as ACKs open
+  the window; only messages the queue cannot take are dropped
+  - sequence numbers are 32 bits and compared as serial numbers
+  (seqnum.h) instead of modulo windowsize + 1, and the window lives in
+  rings sized at run time, so windows of up to MAXWINDOW packets work.
+  A timeout in a window larger than RESENDMAX resends no more than
+  RESENDMAX packets at once, and the rest as ACKs come back; every
+  timeout before the next new ACK halves that, since the copies it
+  resent are still queued up behind the ones in flight
+  - bidirectional transfer (proto_config.bidirectional): A and B each
+  run a sender and a receiver, and every data packet carries the
+  cumulative ACK of its receiver.  A receiver holds the ACK of in-order
+  data back for ACKDELAY, hoping for a data packet to carry it, and
+  sends it on its own when the delayed-ACK timer goes off.  Out of
+  order data is ACKed at once, and only ACK-only packets count as
+  duplicate ACKs
+  - ACK coalescing (proto_config.ackevery and ackdelay): a receiver
+  that delays its ACKs sends one for every ACKEVERY packets received
+  in order, or when the delayed-ACK timer goes off, whichever comes
+  first; being cumulative, it covers them all.  One-way runs can delay
+  ACKs too, to save the ACK-only packets
+  - selective ACKs (proto_config.sack): B buffers packets that arrive
+  out of order within the window instead of discarding them, and its
+  ACK-only packets report them in a SACK (sack.h).  A skips the packets
+  it knows B holds when it resends the window, and a fast retransmit
+  only resends the holes below the highest packet B reported.  ACKs
+  riding on data carry no SACK, the payload is taken
+  - packets are refcounted buffers (pktbuf.h): the window holds the
+  buffer it handed to layer 3 and resends it without copying, and the
+  receiver keeps the buffers of the packets it holds for a gap.  A
+  buffer still in flight is only copied when a new ACK goes on it
+  - congestion control (proto_config.cc): the sender keeps at most its
+  congestion window (cc.h) of packets in flight.  A timeout or fast
+  retransmit that cuts the window down only resends as many packets as
+  it allows; the rest of the window goes again as ACKs make room,
+  before any new packet
+**********************************************************************/
+
+#define RTT  16.0       /* round trip time.  MUST BE SET TO 16.0 when submitting assignment */
+#define WINDOWSIZE 6    /* the maximum number of buffered unacked packet
+                          MUST BE SET TO 6 when submitting assignment */
+#define DUPACKS 3       /* duplicate ACKs that trigger a fast retransmit */
+#define MAXWINDOW 65536 /* largest window that can be configured at run time */
+#define RESENDMAX 64    /* most packets of a resend in flight in a large window */
+#define ACKDELAY 10.0   /* default time an ACK waits for data to ride on */
+#define ACKEVERY 2      /* default number of packets one delayed ACK covers */
+#define ACKTIMER 0      /* logical timer id of the delayed ACK */
+#define NOTINUSE (-1)   /* used to fill header fields that are not being used */
+
+/* generic procedure to compute the checksum of a packet.  Used by both sender and receiver
+   the simulator will overwrite part of your packet with 'z's.  It will not overwrite your
+   original checksum.  This procedure must generate a different checksum to the original if
+   the packet is corrupted.
+*/
+static int ComputeChecksum(const struct pkt *packet)
+{
+  return pkt_checksum(packet, proto_config()->checksum);
+}
+
+static bool IsCorrupted(const struct pkt *packet)
+{
+  if (packet->checksum == ComputeChecksum(packet))
+    return (false);
+  else
+    return (true);
+}
+
+
+/* the sending half of one direction of the transfer */
+struct gbn_sender {
+  struct pkt **buffer;            /* ring of the packets waiting for ACK */
+  double *sendtime;               /* when each buffered packet was first sent */
+  uint64_t *resent;               /* and whether it was sent again since */
+  uint64_t *sacked;               /* and whether a SACK reported it */
+  uint32_t windowbase;            /* seqnum of the first packet awaiting ACK */
+  int windowcount;                /* the number of packets currently awaiting an ACK */
+  uint32_t nextseqnum;            /* the next sequence number to be used by the sender */
+  struct rto rto;                 /* retransmission timeout */
+  struct cc cc;                   /* congestion window */
+  uint32_t resendnext, resendend; /* packets of a resend held back for */
+                                  /* resend_more()                      */
+  bool resendfast;                /* that resend was a fast retransmit */
+  int resendmax;                  /* of them in flight, halved by every */
+                                  /* timeout until a new ACK            */
+  struct sendq queue;             /* messages waiting for room in the window */
+  int dupcount;                   /* duplicate ACKs since the last new one */
+  bool dupvalid;                  /* a packet sent after the last resend was */
+                                  /* ACKed, so duplicates signal a loss      */
+};
+
+/* the receiving half */
+struct gbn_receiver {
+  uint32_t expectedseqnum;        /* the sequence number expected next */
+  int acknextseqnum;              /* seqnum of the next ACK-only packet */
+  uint64_t *received;             /* with SACK: packets buffered ahead of */
+  const struct pkt **rcvbuf;      /* expectedseqnum, in rings             */
+  int unacked;                    /* packets received in order whose ACK is */
+                                  /* held back by the delayed-ACK timer      */
+};
+
+/* all protocol state, one per simulation (see sim_protostate) */
+struct gbn_state {
+  int windowsize;                 /* WINDOWSIZE unless configured otherwise */
+  uint32_t mask;                  /* ring slots - 1 (seqnum.h) */
+  int dupthresh;                  /* DUPACKS unless configured, 0 for none */
+  bool bidirectional;             /* B sends data too */
+  double ackdelay;                /* how long ACKs are held back, 0 for not */
+  int ackevery;                   /* packets after which they are sent anyway */
+  bool sack;                      /* selective ACKs */
+
+  /* by entity: A's sender and B's receiver make up the A->B transfer */
+  struct gbn_sender snd[2];
+  struct gbn_receiver rcv[2];
+};
+
+static struct gbn_state *gbn(void)
+{
+  return sim_protostate(sizeof(struct gbn_state));
+}
+
+/* pick up the window size of this simulation */
+static void gbn_configure(struct gbn_state *s)
+{
+  s->windowsize = proto_config()->windowsize;
+  if (s->windowsize <= 0)
+    s->windowsize = WINDOWSIZE;
+  if (s->windowsize > MAXWINDOW) {
+    printf("Warning: window size %d too large, using %d\n", s->windowsize, MAXWINDOW);
+    s->windowsize = MAXWINDOW;
+  }
+  s->mask = ring_size(s->windowsize) - 1;
+  s->dupthresh = proto_config()->dupacks;
+  if (s->dupthresh == 0)
+    s->dupthresh = DUPACKS;
+  else if (s->dupthresh < 0)
+    s->dupthresh = 0;
+  /* ACKs are delayed by default only when data going the other way */
+  /* can carry them, or when asked to coalesce them                   */
+  s->bidirectional = proto_config()->bidirectional != 0;
+  s->ackdelay = proto_config()->ackdelay;
+  s->ackevery = proto_config()->ackevery;
+  if (s->ackdelay == 0.0 && (s->bidirectional || s->ackevery > 1 || s->ackevery < 0))
+    s->ackdelay = ACKDELAY;
+  if (s->ackdelay <= 0.0 || s->ackevery == 1) {
+    s->ackdelay = 0.0;
+    s->ackevery = 1;
+  }
+  else if (s->ackevery == 0)
+    s->ackevery = ACKEVERY;
+  else if (s->ackevery < 0)
+    s->ackevery = INT_MAX;
+  s->sack = proto_config()->sack != 0;
+}
+
+/* the statistics follow the timeout of A, the sender of a one-way transfer */
+static void publish_rto(struct gbn_state *s, int entity)
+{
+  if (entity == A)
+    rto_stats(&s->snd[A].rto, sim_stats());
+}
+
+/* and the congestion window */
+static void publish_cc(struct gbn_state *s, int entity)
+{
+  if (entity == A)
+    cc_stats(&s->snd[A].cc, sim_stats());
+  sim_cwnd(entity, s->snd[entity].cc.cwnd);
+}
+
+
+/********* Sender variables and functions ************/
+
+/* send the packet in *bufp, a slot of entity's window, which keeps its */
+/* reference for resending; in a bidirectional run it carries the      */
+/* latest ACK of entity's receiver, which need not be sent alone        */
+static void transmit(struct gbn_state *s, int entity, struct pkt **bufp)
+{
+  struct gbn_receiver *r = &s->rcv[entity];
+  struct pkt *packet = *bufp;
+
+  if (s->bidirectional) {
+    if (packet->acknum != (int)(r->expectedseqnum - 1) || !(packet->flags & PKT_ACK)) {
+      /* a copy still in flight keeps the ACK it was sent with */
+      packet = *bufp = pkt_unshare(packet);
+      packet->acknum = (int)(r->expectedseqnum - 1);
+      packet->flags |= PKT_ACK;
+      packet->checksum = ComputeChecksum(packet);
+    }
+    if (r->unacked > 0) {
+      r->unacked = 0;
+      stoptimer_id(entity, ACKTIMER);
+      sim_stats()->acks_piggybacked++;
+    }
+  }
+  tolayer3_buf(entity, pkt_hold(packet));
+}
+
+/* put message in the window and send it; there must be room */
+static void send_message(struct gbn_state *s, int entity, const struct msg *message)
+{
+  struct gbn_sender *snd = &s->snd[entity];
+  struct pkt *sendpkt;
+  uint32_t slot;
+
+  /* create packet in a buffer the window holds */
+  slot = snd->nextseqnum & s->mask;
+  sendpkt = pkt_alloc();
+  sendpkt->seqnum = snd->nextseqnum;
+  sendpkt->acknum = NOTINUSE;
+  sendpkt->flags = PKT_DATA;
+  sendpkt->length = message->length;
+  memcpy(sendpkt->payload, message->data, message->length);
+  sendpkt->checksum = ComputeChecksum(sendpkt);
+  snd->buffer[slot] = sendpkt;
+  snd->sendtime[slot] = sim_time();
+  bitmap_clear(snd->resent, slot);
+  if (s->sack)
+    bitmap_clear(snd->sacked, slot);
+  snd->windowcount++;
+  sim_window(entity, snd->windowcount);
+
+  /* send out packet */
+  TRACE_LOG(0, TR_A_SEND, entity, sendpkt->seqnum);
+  transmit(s, entity, &snd->buffer[slot]);
+
+  /* start timer if first packet in window */
+  if (snd->windowcount == 1)
+    starttimer(entity, rto_get(&snd->rto));
+
+  /* get next sequence number, wraps back to 0 after 2^32 */
+  snd->nextseqnum++;
+}
+
+/* how far past windowbase a resend may go: the congestion window,   */
+/* and in a window larger than RESENDMAX no more than resendmax.  A   */
+/* timeout that resent a whole large window at once would queue it up */
+/* behind the copies still in flight, and every timeout after it,     */
+/* before any of them got through, would add another window           */
+static int resend_room(const struct gbn_state *s, const struct gbn_sender *snd)
+{
+  int room = cc_window(&snd->cc);
+
+  if (s->windowsize > RESENDMAX && room > snd->resendmax)
+    return snd->resendmax;
+  return room;
+}
+
+/* whether a new packet fits in the window: in the congestion window */
+/* too, once the packets held back from a resend have gone            */
+static bool window_open(const struct gbn_sender *snd)
+{
+  return snd->windowcount < cc_window(&snd->cc) && snd->resendnext == snd->resendend;
+}
+
+/* called from layer 5 (application layer), passed the message to be sent to other side */
+static void output(struct gbn_state *s, int entity, const struct msg *message)
+{
+  struct gbn_sender *snd = &s->snd[entity];
+
+  /* if not blocked waiting on ACK, and no earlier message is waiting */
+  if (window_open(snd) && snd->queue.count == 0) {
+    TRACE_LOG(1, TR_A_NEWMSG, entity, 0);
+    send_message(s, entity, message);
+  }
+  /* if blocked,  window is full */
+  else if (sendq_push(&snd->queue, message))
+    TRACE_LOG(1, TR_A_QUEUE, entity, snd->queue.count);
+  else {
+    TRACE_LOG(0, TR_A_NEWMSG_FULL, entity, 0);
+    sim_stats()->window_full++;
+  }
+}
+
+
+/* resend every packet in the window and restart the timer; with SACK */
+/* only those the receiver did not report, and on a fast retransmit   */
+/* only the holes below the highest one it did.  Returns the number   */
+/* of packets resent.  Those past resend_room() are held back for     */
+/* resend_more()                                                      */
+static int resend_window(struct gbn_state *s, int entity, bool fast)
+{
+  struct gbn_sender *snd = &s->snd[entity];
+  uint32_t slot;
+  int i, last = snd->windowcount, nresent = 0, room = resend_room(s, snd);
+
+  if (s->sack && fast) {
+    /* the first packet is lost, whatever the SACKs say */
+    for (last = snd->windowcount - 1; last > 0; last--)
+      if (bitmap_test(snd->sacked, (snd->windowbase + last) & s->mask))
+        break;
+    last++;
+  }
+  snd->resendnext = snd->resendend = snd->windowbase + last;
+  snd->resendfast = fast;
+  for(i=0; i<last; i++) {
+    if (i == room) {
+      /* the packets held back count as resent from now on: a copy */
+      /* the receiver already holds is only ACKed once the hole is  */
+      /* filled, and its round trip would measure the recovery      */
+      snd->resendnext = snd->windowbase + i;
+      for (; i < snd->windowcount; i++)
+        bitmap_set(snd->resent, (snd->windowbase + i) & s->mask);
+      break;
+    }
+    slot = (snd->windowbase + i) & s->mask;
+    if (s->sack && bitmap_test(snd->sacked, slot))
+      continue;
+
+    TRACE_LOG(0, TR_A_RESEND, entity, snd->buffer[slot]->seqnum);
+
+    transmit(s, entity, &snd->buffer[slot]);
+    bitmap_set(snd->resent, slot);
+    sim_stats()->packets_resent++;
+    if (nresent++ == 0) starttimer(entity, rto_get(&snd->rto));
+  }
+  snd->dupcount = 0;
+  snd->dupvalid = false;
+  return nresent;
+}
+
+/* resend the packets resend_window() held back, as far as */
+/* resend_room() has room for them now                      */
+static void resend_more(struct gbn_state *s, int entity)
+{
+  struct gbn_sender *snd = &s->snd[entity];
+  uint32_t slot;
+
+  if (snd->resendnext == snd->resendend)
+    return;
+  if (seq_lt(snd->resendnext, snd->windowbase))
+    snd->resendnext = snd->windowbase;
+  if (seq_lt(snd->resendend, snd->resendnext))
+    snd->resendend = snd->resendnext;
+  while (snd->resendnext != snd->resendend &&
+         (int)seq_dist(snd->windowbase, snd->resendnext) < resend_room(s, snd)) {
+    slot = snd->resendnext++ & s->mask;
+    if (s->sack && bitmap_test(snd->sacked, slot))
+      continue;
+
+    TRACE_LOG(0, TR_A_RESEND, entity, snd->buffer[slot]->seqnum);
+
+    transmit(s, entity, &snd->buffer[slot]);
+    bitmap_set(snd->resent, slot);
+    sim_stats()->packets_resent++;
+    if (snd->resendfast)
+      sim_stats()->packets_fastresent++;
+  }
+}
+
+/* note the packets of entity's window a SACK reports as received, and */
+/* measure the round trip on the newest, unless it was resent; later  */
+/* its cumulative ACK will have waited for the holes before it        */
+static void receive_sack(struct gbn_state *s, int entity, const struct pkt *packet)
+{
+  struct gbn_sender *snd = &s->snd[entity];
+  uint32_t seq, slot, end, first;
+  int newest = -1;
+
+  /* the SACK only reports packets up to SACK_BITS past its base */
+  end = sack_base(packet->payload) + 1 + SACK_BITS;
+  if (seq_lt(snd->nextseqnum, end))
+    end = snd->nextseqnum;
+  /* the packets before the base are the cumulative ACK's business */
+  first = sack_base(packet->payload) + 1;
+  if (seq_lt(first, snd->windowbase))
+    first = snd->windowbase;
+  for (seq = first; seq_lt(seq, end); seq++) {
+    slot = seq & s->mask;
+    if (!bitmap_test(snd->sacked, slot) && sack_test(packet->payload, seq)) {
+      bitmap_set(snd->sacked, slot);
+      sim_stats()->packets_sacked++;
+      newest = (int)slot;
+    }
+  }
+  if (newest >= 0 && !bitmap_test(snd->resent, (uint32_t)newest)) {
+    rto_sample(&snd->rto, sim_time() - snd->sendtime[newest]);
+    publish_rto(s, entity);
+  }
+}
+
+/* an uncorrupted ACK arrived for entity's sender, on its own or on data */
+static void receive_ack(struct gbn_state *s, int entity, const struct pkt *packet)
+{
+  struct gbn_sender *snd = &s->snd[entity];
+  struct msg message;
+  uint32_t ack = (uint32_t)packet->acknum;
+  uint32_t slot;
+  int i, ackcount = 0;
+
+  TRACE_LOG(0, TR_A_ACK, entity, packet->acknum);
+  sim_stats()->total_ACKs_received++;
+  if (s->sack && (packet->flags & PKT_SACK))
+    receive_sack(s, entity, packet);
+
+  /* check if new ACK or duplicate */
+  if (snd->windowcount != 0) {
+        /* serial number comparison copes with wrapped sequence numbers */
+        if (seq_le(snd->windowbase, ack) && seq_lt(ack, snd->nextseqnum)) {
+
+          /* packet is a new ACK */
+          TRACE_LOG(0, TR_A_NEWACK, entity, packet->acknum);
+          sim_stats()->new_ACKs++;
+          snd->dupcount = 0;
+          snd->resendmax = RESENDMAX;
+
+          /* cumulative acknowledgement - determine how many packets are ACKed */
+          ackcount = (int)seq_dist(snd->windowbase, ack) + 1;
+
+          /* measure the round trip on the newest packet ACKed, unless */
+          /* it was resent (Karn's rule)                                */
+          slot = ack & s->mask;
+          if (s->sack && bitmap_test(snd->sacked, slot))
+            rto_progress(&snd->rto);   /* measured when it was SACKed */
+          else if (!bitmap_test(snd->resent, slot)) {
+            rto_sample(&snd->rto, sim_time() - snd->sendtime[slot]);
+            snd->dupvalid = true;
+          }
+          else
+            rto_progress(&snd->rto);
+          publish_rto(s, entity);
+
+          /* slide window by the number of packets ACKed, letting go of them */
+          for (i = 0; i < ackcount; i++) {
+            slot = (snd->windowbase + i) & s->mask;
+            pkt_release(snd->buffer[slot]);
+            snd->buffer[slot] = NULL;
+          }
+          snd->windowbase += ackcount;
+          snd->windowcount -= ackcount;
+          sim_window(entity, snd->windowcount);
+
+          /* start timer again if there are still more unacked packets in window */
+          stoptimer(entity);
+          if (snd->windowcount > 0)
+            starttimer(entity, rto_get(&snd->rto));
+
+          /* open the congestion window; a NewReno partial ACK needs no */
+          /* resend of its own, the rest of the window went again       */
+          cc_ack(&snd->cc, ackcount, snd->windowbase);
+          publish_cc(s, entity);
+          resend_more(s, entity);
+
+          /* fill the window from the send queue */
+          while (window_open(snd) && sendq_pop(&snd->queue, &message))
+            send_message(s, entity, &message);
+
+        }
+        /* the receiver re-ACKs the packet before the window for every   */
+        /* packet it had to discard: the first packet in the window is   */
+        /* lost.  Data packets repeat the ACK whenever the other side    */
+        /* has nothing new to acknowledge, so only ACK-only packets count */
+        else if (ack == snd->windowbase - 1 && !(packet->flags & PKT_DATA) &&
+                 s->dupthresh > 0 && snd->dupvalid && ++snd->dupcount == s->dupthresh) {
+          TRACE_LOG(0, TR_A_FASTRETX, entity, snd->dupcount);
+          sim_stats()->fast_retransmits++;
+          cc_loss(&snd->cc, snd->windowcount, snd->windowbase, snd->nextseqnum);
+          publish_cc(s, entity);
+          stoptimer(entity);
+          sim_stats()->packets_fastresent += resend_window(s, entity, true);
+        }
+        else
+          TRACE_LOG(0, TR_A_DUPACK, entity, 0);
+      }
+      else
+        TRACE_LOG(0, TR_A_DUPACK, entity, 0);
+}
+
+/* called when the sender's timer goes off */
+static void timerinterrupt(struct gbn_state *s, int entity)
+{
+  struct gbn_sender *snd = &s->snd[entity];
+
+  TRACE_LOG(0, TR_A_TIMEOUT, entity, 0);
+  rto_timeout(&snd->rto);
+  publish_rto(s, entity);
+  cc_timeout(&snd->cc, snd->windowcount, snd->windowbase, snd->nextseqnum);
+  publish_cc(s, entity);
+  resend_window(s, entity, false);
+  if (snd->resendmax > 1)
+    snd->resendmax /= 2;
+}
+
+/* initialise entity's window, buffer and sequence number */
+static void sender_init(struct gbn_state *s, int entity)
+{
+  struct gbn_sender *snd = &s->snd[entity];
+
+  snd->buffer = sim_alloc((s->mask + 1) * sizeof(struct pkt *));
+  snd->sendtime = sim_alloc((s->mask + 1) * sizeof(double));
+  snd->resent = sim_alloc(BITMAP_WORDS(s->mask + 1) * sizeof(uint64_t));
+  if (s->sack)
+    snd->sacked = sim_alloc(BITMAP_WORDS(s->mask + 1) * sizeof(uint64_t));
+  snd->nextseqnum = 0;  /* A starts with seq num 0, do not change this */
+  snd->windowbase = 0;
+  snd->windowcount = 0;
+  snd->dupcount = 0;
+  snd->dupvalid = true;
+  snd->resendnext = snd->resendend = 0;
+  snd->resendmax = RESENDMAX;
+  sendq_init(&snd->queue, entity, proto_config()->sendqueue, sim_backpressure);
+  rto_init(&snd->rto, RTT, s->ackdelay, proto_config()->fixedrto, s->windowsize);
+  publish_rto(s, entity);
+  cc_init(&snd->cc, proto_config()->cc, s->windowsize);
+  publish_cc(s, entity);
+}
+
+
+
+/********* Receiver variables and procedures ************/
+
+/* send the receiver's cumulative ACK in a packet of its own */
+static void send_ack(struct gbn_state *s, int entity)
+{
+  struct gbn_receiver *r = &s->rcv[entity];
+  struct pkt *sendpkt = pkt_alloc();
+
+  /* the last packet received in order; before the first packet that */
+  /* is the sequence number before 0                                  */
+  sendpkt->acknum = (int)(r->expectedseqnum - 1);
+  sendpkt->flags = PKT_ACK;
+
+  /* create packet */
+  sendpkt->seqnum = r->acknextseqnum;
+  r->acknextseqnum = (r->acknextseqnum + 1) % 2;
+
+  /* we don't have any data to send.  The payload is empty, or the */
+  /* SACK of the packets buffered                                   */
+  if (s->sack) {
+    sack_encode(sendpkt->payload, r->expectedseqnum, r->received, s->mask, s->windowsize);
+    sendpkt->length = SACK_SIZE;
+    sendpkt->flags |= PKT_SACK;
+  }
+  else
+    sendpkt->length = 0;
+
+  /* computer checksum */
+  sendpkt->checksum = ComputeChecksum(sendpkt);
+
+  /* send out packet */
+  tolayer3_buf(entity, sendpkt);
+  sim_stats()->acks_alone++;
+  if (r->unacked > 0) {
+    r->unacked = 0;
+    stoptimer_id(entity, ACKTIMER);
+  }
+}
+
+/* an uncorrupted data packet arrived for entity's receiver */
+static void receive_data(struct gbn_state *s, int entity, const struct pkt *packet)
+{
+  struct gbn_receiver *r = &s->rcv[entity];
+  uint32_t seq = (uint32_t)packet->seqnum;
+  bool filled = false;
+
+  /* if received packet is in order */
+  if (seq == r->expectedseqnum) {
+    TRACE_LOG(0, TR_B_RECV, entity, packet->seqnum);
+    sim_stats()->packets_received++;
+
+    /* deliver to receiving application */
+    tolayer5_len(entity, packet->payload, packet->length);
+
+    /* update state variables */
+    r->expectedseqnum++;
+
+    /* with SACK the packet may fill a gap: deliver what it lets out */
+    while (s->sack && bitmap_test(r->received, r->expectedseqnum & s->mask)) {
+      bitmap_clear(r->received, r->expectedseqnum & s->mask);
+      tolayer5_len(entity, r->rcvbuf[r->expectedseqnum & s->mask]->payload,
+                   r->rcvbuf[r->expectedseqnum & s->mask]->length);
+      pkt_release(r->rcvbuf[r->expectedseqnum & s->mask]);
+      r->expectedseqnum++;
+      filled = true;
+    }
+
+    /* send an ACK for the received packet, unless it can wait for data */
+    /* going the other way or for more packets; one ACK then covers     */
+    /* everything received.  A filled gap is ACKed at once              */
+    if (s->ackdelay == 0.0 || filled || ++r->unacked >= s->ackevery)
+      send_ack(s, entity);
+    else if (r->unacked == 1)
+      starttimer_id(entity, ACKTIMER, s->ackdelay);
+  }
+  else if (s->sack && seq_lt(r->expectedseqnum, seq) &&
+           seq_dist(r->expectedseqnum, seq) < (uint32_t)s->windowsize) {
+    /* ahead of a hole: buffer it and tell the sender at once */
+    if (!bitmap_test(r->received, seq & s->mask)) {
+      TRACE_LOG(0, TR_B_BUFFER, entity, packet->seqnum);
+      sim_stats()->packets_received++;
+      bitmap_set(r->received, seq & s->mask);
+      r->rcvbuf[seq & s->mask] = pkt_hold(packet);
+    }
+    else
+      TRACE_LOG(0, TR_B_DUP, entity, packet->seqnum);
+    send_ack(s, entity);
+  }
+  else {
+    /* packet is out of order: resend last ACK at once, the sender */
+    /* counts the duplicates                                       */
+    TRACE_LOG(0, TR_B_BADPKT, entity, 0);
+    send_ack(s, entity);
+  }
+}
+
+/* the delayed-ACK timer went off without data to carry the ACK */
+static void acktimeout(struct gbn_state *s, int entity)
+{
+  struct gbn_receiver *r = &s->rcv[entity];
+
+  TRACE_LOG(0, TR_B_DELACK, entity, (int)(r->expectedseqnum - 1));
+  r->unacked = 0;
+  sim_stats()->acks_delayed++;
+  send_ack(s, entity);
+}
+
+/* a logical timer of entity went off: the delayed ACK is the only one */
+static void entity_timeout(int entity, int id)
+{
+  if (id == ACKTIMER)
+    acktimeout(gbn(), entity);
+  else
+    printf("INTERNAL PANIC: no handler for timer %d\n", id);
+}
+
+static void receiver_init(struct gbn_state *s, int entity)
+{
+  struct gbn_receiver *r = &s->rcv[entity];
+
+  r->expectedseqnum = 0;
+  r->acknextseqnum = 1;
+  r->unacked = 0;
+  if (s->sack) {
+    r->received = sim_alloc(BITMAP_WORDS(s->mask + 1) * sizeof(uint64_t));
+    r->rcvbuf = sim_alloc((s->mask + 1) * sizeof(struct pkt *));
+  }
+}
+
+/* called from layer 3, when a packet arrives for layer 4 at entity; */
+/* the buffer is only lent for the call                              */
+static void input(struct gbn_state *s, int entity, const struct pkt *packet)
+{
+  if (IsCorrupted(packet)) {
+    /* the channel leaves the flags alone: a corrupted data packet is */
+    /* answered with the last ACK, a corrupted ACK is ignored          */
+    if (packet->flags & PKT_DATA) {
+      TRACE_LOG(0, TR_B_BADPKT, entity, 0);
+      send_ack(s, entity);
+    }
+    else
+      TRACE_LOG(0, TR_A_CORRUPTACK, entity, 0);
+    return;
+  }
+  /* data first, so that messages the ACK lets out carry its ACK */
+  if (packet->flags & PKT_DATA)
+    receive_data(s, entity, packet);
+  if (packet->flags & PKT_ACK)
+    receive_ack(s, entity, packet);
+}
+
+
+/* the by-value entry point: the packet goes into a buffer of its own */
+static void input_copy(int entity, struct pkt packet)
+{
+  struct pkt *buf = pkt_alloc();
+
+  pkt_copy(buf, &packet);
+  input(gbn(), entity, buf);
+  pkt_release(buf);
+}
+
+
+/********* Entity routines called by the emulator ************/
+
+static void A_output(struct msg message)
+{
+  output(gbn(), A, &message);
+}
+
+static void A_input(struct pkt packet)
+{
+  input_copy(A, packet);
+}
+
+static void A_input_buf(const struct pkt *packet)
+{
+  input(gbn(), A, packet);
+}
+
+/* called when A's timer goes off */
+static void A_timerinterrupt(void)
+{
+  timerinterrupt(gbn(), A);
+}
+
+/* called when A's delayed-ACK timer goes off */
+static void A_timeout(int id)
+{
+  entity_timeout(A, id);
+}
+
+/* the following routine will be called once (only) before any other */
+/* entity A routines are called. You can use it to do any initialization */
+static void A_init(void)
+{
+  struct gbn_state *s = gbn();
+
+  gbn_configure(s);
+  sender_init(s, A);
+  if (s->bidirectional)
+    receiver_init(s, A);
+}
+
+/* B sends through the same output() path when the transfer is bidirectional */
+static void B_output(struct msg message)
+{
+  output(gbn(), B, &message);
+}
+
+static void B_input(struct pkt packet)
+{
+  input_copy(B, packet);
+}
+
+static void B_input_buf(const struct pkt *packet)
+{
+  input(gbn(), B, packet);
+}
+
+/* called when B's timer goes off */
+static void B_timerinterrupt(void)
+{
+  timerinterrupt(gbn(), B);
+}
+
+/* called when B's delayed-ACK timer goes off */
+static void B_timeout(int id)
+{
+  entity_timeout(B, id);
+}
+
+/* the following routine will be called once (only) before any other */
+/* entity B routines are called. You can use it to do any initialization */
+static void B_init(void)
+{
+  struct gbn_state *s = gbn();
+
+  gbn_configure(s);
+  if (s->bidirectional)
+    sender_init(s, B);
+  receiver_init(s, B);
+}
+
+const struct transport_ops gbn_ops = {
+  "gbn",
+  A_init,
+  B_init,
+  A_output,
+  A_input,
+  A_timerinterrupt,
+  B_output,
+  B_input,
+  B_timerinterrupt,
+  A_timeout,
+  B_timeout,
+  A_input_buf,
+  B_input_buf
+};
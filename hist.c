@@ -0,0 +1,86 @@
+#include <string.h>
+#include "hist.h"
+
+/* ******************************************************************
+   Log-linear histograms.  See hist.h.
+**********************************************************************/
+
+static int msb(unsigned long long v)
+{
+  int n = 0;
+
+  while (v >>= 1)
+    n++;
+  return n;
+}
+
+static int hist_index(unsigned long long ticks)
+{
+  int shift;
+
+  if (ticks < HIST_SUB)
+    return (int)ticks;
+  shift = msb(ticks) - HIST_SUBBITS;
+  if (shift > HIST_MAXBITS - HIST_SUBBITS - 1)
+    return HIST_NBUCKETS - 1;
+  return (shift + 1) * HIST_SUB + (int)((ticks >> shift) - HIST_SUB);
+}
+
+/* largest value, in ticks, that falls into bucket i */
+static unsigned long long hist_top(int i)
+{
+  int shift;
+
+  if (i < HIST_SUB)
+    return i;
+  shift = i / HIST_SUB - 1;
+  return ((unsigned long long)(i % HIST_SUB + HIST_SUB + 1) << shift) - 1;
+}
+
+void hist_init(struct hist *h)
+{
+  memset(h, 0, sizeof(struct hist));
+}
+
+void hist_record(struct hist *h, double v)
+{
+  if (v < 0.0)
+    v = 0.0;
+  if (h->count == 0 || v < h->min)
+    h->min = v;
+  if (h->count == 0 || v > h->max)
+    h->max = v;
+  h->count++;
+  h->sum += v;
+  h->bucket[hist_index((unsigned long long)(v / HIST_UNIT))]++;
+}
+
+double hist_quantile(const struct hist *h, double q)
+{
+  unsigned long long rank, seen;
+  double v;
+  int i;
+
+  if (h->count == 0)
+    return 0.0;
+  rank = (unsigned long long)(q * h->count + 0.5);
+  if (rank < 1)
+    rank = 1;
+  for (seen = 0, i = 0; i < HIST_NBUCKETS; i++) {
+    seen += h->bucket[i];
+    if (seen >= rank)
+      break;
+  }
+  /* report the top of the bucket, but never beyond what was seen */
+  v = (hist_top(i) + 1) * HIST_UNIT;
+  if (v > h->max)
+    v = h->max;
+  if (v < h->min)
+    v = h->min;
+  return v;
+}
+
+double hist_mean(const struct hist *h)
+{
+  return h->count ? h->sum / h->count : 0.0;
+}
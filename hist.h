@@ -0,0 +1,32 @@
+/* ******************************************************************
+   Log-linear histograms in the style of HdrHistogram.
+
+   Values are counted in ticks of HIST_UNIT simulated time units.
+   Below 2^HIST_SUBBITS ticks every tick has its own bucket; above it
+   each power of two is split into 2^HIST_SUBBITS equal buckets, so a
+   recorded value is known to within 1/2^HIST_SUBBITS (1.6%) of itself
+   over the whole range while the histogram stays a fixed array.
+**********************************************************************/
+#ifndef HIST_H
+#define HIST_H
+
+#define HIST_UNIT     0.001   /* resolution, in time units */
+#define HIST_SUBBITS  6
+#define HIST_MAXBITS  48      /* values up to 2^48 ticks */
+#define HIST_SUB      (1 << HIST_SUBBITS)
+#define HIST_NBUCKETS ((HIST_MAXBITS - HIST_SUBBITS + 1) * HIST_SUB)
+
+struct hist {
+  unsigned long long count;
+  double sum;
+  double min, max;        /* exact, not bucketed */
+  unsigned long long bucket[HIST_NBUCKETS];
+};
+
+extern void hist_init(struct hist *h);
+extern void hist_record(struct hist *h, double v);
+/* value below which a fraction q of the recorded values lie, 0 if empty */
+extern double hist_quantile(const struct hist *h, double q);
+extern double hist_mean(const struct hist *h);
+
+#endif
@@ -0,0 +1,236 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+#include "checksum.h"
+#include "cc.h"
+
+/* ******************************************************************
+   Interactive front end of the network emulator: reads one
+   configuration from stdin, runs it and prints the statistics.
+
+   Environment:
+   EMU_PROTO=gbn|sr                     transport protocol, gbn by default
+   EMU_SCHED=list|heap|heap4|calendar   event scheduler
+   EMU_RNG=compat|xoshiro               random number generator
+   EMU_SEED=n                           seed, 9999 by default
+   EMU_TRACEFILE=path                   write TRACE output to a binary
+                                        trace file, see tracedump.c
+   EMU_TRACESIZE=n                      records kept in that file
+   EMU_WINDOW=n                         send window, up to 65536 packets
+   EMU_RTO=adaptive|fixed               retransmission timeout, fixed is
+                                        the constant RTT of the assignment
+   EMU_DUPACKS=n                        duplicate ACKs that trigger a fast
+                                        retransmit, -1 for none
+   EMU_QUEUE=n                          queue up to n messages while the
+                                        send window is full
+   EMU_BACKPRESSURE=1                   layer 5 waits while that queue is
+                                        full instead of losing messages
+   EMU_BIDIR=1                          B's layer 5 sends messages too, and
+                                        ACKs ride on data packets
+   EMU_ACKDELAY=t                       time an ACK waits for data to carry
+                                        it, -1 to send it at once
+   EMU_ACKEVERY=n                       packets one delayed ACK covers at
+                                        most, -1 for no limit
+   EMU_SACK=1                           receivers buffer out of order data
+                                        and report it in selective ACKs
+   EMU_CHECKSUM=sum|inet|crc32c         packet checksum, sum by default
+   EMU_CC=none|aimd|newreno             congestion window of the senders,
+                                        none for the fixed window
+   EMU_MSGSIZE=n                        mean message size in bytes, up to
+                                        9000, 20 by default
+   EMU_MSGDIST=fixed|uniform|exp|imix   distribution of message sizes
+   EMU_BANDWIDTH=bps                    link bandwidth in bits per time
+                                        unit, which gives the links a
+                                        queue; 0 for the random delay
+   EMU_PROPDELAY=t                      propagation delay of the links
+   EMU_LINKQUEUE=n                      packets a link queue holds
+   EMU_LINKBYTES=n                      bytes a link queue holds
+   EMU_AQM=droptail|red                 link queue discipline
+   EMU_RED=min,max,maxp,weight          RED thresholds in packets, drop
+                                        probability at max, and weight
+                                        of the average; 0 for defaults
+   EMU_LOSSMODEL=bernoulli|ge           independent losses of the loss
+                                        probability, or Gilbert-Elliott
+                                        bursts
+   EMU_GE=p,r,good,bad                  Gilbert-Elliott chance to go bad
+                                        and good again per packet, and
+                                        loss probability in each state
+   EMU_REORDER=prob,depth               chance that a packet may overtake
+                                        up to depth others
+   EMU_DUP=prob                         chance that a packet arrives twice
+   The link parameters are "x" for both links or "x:y", x for the A->B
+   link and y for the B->A link.
+   EMU_SAMPLE=t                         print the send window, messages
+                                        delivered and timeout every t
+**********************************************************************/
+
+/* the link parameter var, "x" or "x:y", as the values of the A->B */
+/* and B->A links; 0 if var is not set                              */
+static int linkenv(const char *var, char *value[2])
+{
+  static char buf[2][64];
+  char *name = getenv(var), *colon;
+
+  if (name == NULL)
+    return 0;
+  snprintf(buf[0], sizeof(buf[0]), "%s", name);
+  value[0] = value[1] = buf[0];
+  if ((colon = strchr(buf[0], ':')) != NULL) {
+    *colon = '\0';
+    value[1] = colon + 1;
+  }
+  return 1;
+}
+
+static void init_links(struct sim_config *cfg)
+{
+  struct link_config *l;
+  char *value[2];
+  int i;
+
+  for (i = 0; i < 2; i++) {
+    l = &cfg->link[i];
+    if (linkenv("EMU_BANDWIDTH", value))
+      l->bandwidth = strtod(value[i], NULL);
+    if (linkenv("EMU_PROPDELAY", value))
+      l->propdelay = strtod(value[i], NULL);
+    if (linkenv("EMU_LINKQUEUE", value))
+      l->qlimit = (int)strtol(value[i], NULL, 0);
+    if (linkenv("EMU_LINKBYTES", value))
+      l->qbytes = (int)strtol(value[i], NULL, 0);
+    if (linkenv("EMU_AQM", value) && (l->aqm = link_aqm_byname(value[i])) < 0) {
+      printf("unknown EMU_AQM \"%s\" (use droptail or red)\n", value[i]);
+      exit(EXIT_FAILURE);
+    }
+    if (linkenv("EMU_RED", value))
+      sscanf(value[i], "%lf,%lf,%lf,%lf", &l->red_min, &l->red_max, &l->red_maxp,
+             &l->red_weight);
+    if (linkenv("EMU_LOSSMODEL", value) && (l->loss = link_loss_byname(value[i])) < 0) {
+      printf("unknown EMU_LOSSMODEL \"%s\" (use bernoulli or ge)\n", value[i]);
+      exit(EXIT_FAILURE);
+    }
+    if (linkenv("EMU_GE", value))
+      sscanf(value[i], "%lf,%lf,%lf,%lf", &l->ge_p, &l->ge_r, &l->ge_good, &l->ge_bad);
+    if (linkenv("EMU_REORDER", value))
+      sscanf(value[i], "%lf,%d", &l->reorder, &l->reorder_depth);
+    if (linkenv("EMU_DUP", value))
+      l->dup = strtod(value[i], NULL);
+  }
+}
+
+static void init(struct sim_config *cfg)   /* read the simulation parameters */
+{
+  char *name;
+
+  sim_defaults(cfg);
+  cfg->corruptdirection = 0;
+  printf("-----  Stop and Wait Network Simulator Version 1.1 -------- \n\n");
+  printf("Enter the number of messages to simulate: ");
+  scanf("%d",&cfg->nsimmax);
+  printf("Enter  packet loss probability [enter 0.0 for no loss]:");
+  scanf("%f",&cfg->lossprob);
+  printf("Enter packet corruption probability [0.0 for no corruption]:");
+  scanf("%f",&cfg->corruptprob);
+  if (cfg->lossprob != 0.0 || cfg->corruptprob != 0.0) {
+    printf("If you want loss or corruption to only occur in one direction, choose the direction: 0 A->B, 1 A<-B, 2 A<->B (both directions) :");
+    scanf("%d",&cfg->corruptdirection);
+  }
+  printf("Enter average time between messages from sender's layer5 [ > 0.0]:");
+  scanf("%f",&cfg->lambda);
+  printf("Enter TRACE:");
+  scanf("%d",&cfg->trace);
+
+  name = getenv("EMU_PROTO");     /* pick the protocol */
+  if (name != NULL && (cfg->transport = transport_byname(name)) == NULL) {
+    printf("unknown EMU_PROTO \"%s\" (use gbn or sr)\n", name);
+    exit(EXIT_FAILURE);
+  }
+  name = getenv("EMU_SCHED");     /* pick the event scheduler */
+  if (name != NULL && (cfg->sched = sched_byname(name)) < 0) {
+    printf("unknown EMU_SCHED \"%s\" (use list, heap, heap4 or calendar)\n", name);
+    exit(EXIT_FAILURE);
+  }
+  name = getenv("EMU_RNG");       /* and the random number generator */
+  if (name != NULL && (cfg->rng = rng_byname(name)) < 0) {
+    printf("unknown EMU_RNG \"%s\" (use compat or xoshiro)\n", name);
+    exit(EXIT_FAILURE);
+  }
+  name = getenv("EMU_SEED");
+  if (name != NULL)
+    cfg->seed = (unsigned int)strtoul(name, NULL, 0);
+  cfg->tracefile = getenv("EMU_TRACEFILE");
+  name = getenv("EMU_TRACESIZE");
+  if (name != NULL)
+    cfg->tracesize = (unsigned int)strtoul(name, NULL, 0);
+  name = getenv("EMU_WINDOW");
+  if (name != NULL)
+    cfg->proto.windowsize = (int)strtol(name, NULL, 0);
+  name = getenv("EMU_RTO");
+  if (name != NULL) {
+    if (strcmp(name, "fixed") == 0)
+      cfg->proto.fixedrto = 1;
+    else if (strcmp(name, "adaptive") != 0) {
+      printf("unknown EMU_RTO \"%s\" (use adaptive or fixed)\n", name);
+      exit(EXIT_FAILURE);
+    }
+  }
+  name = getenv("EMU_DUPACKS");
+  if (name != NULL)
+    cfg->proto.dupacks = (int)strtol(name, NULL, 0);
+  name = getenv("EMU_QUEUE");
+  if (name != NULL)
+    cfg->proto.sendqueue = (int)strtol(name, NULL, 0);
+  name = getenv("EMU_BACKPRESSURE");
+  if (name != NULL)
+    cfg->backpressure = (int)strtol(name, NULL, 0);
+  name = getenv("EMU_BIDIR");
+  if (name != NULL)
+    cfg->proto.bidirectional = (int)strtol(name, NULL, 0);
+  name = getenv("EMU_ACKDELAY");
+  if (name != NULL)
+    cfg->proto.ackdelay = strtod(name, NULL);
+  name = getenv("EMU_ACKEVERY");
+  if (name != NULL)
+    cfg->proto.ackevery = (int)strtol(name, NULL, 0);
+  name = getenv("EMU_SACK");
+  if (name != NULL)
+    cfg->proto.sack = (int)strtol(name, NULL, 0);
+  name = getenv("EMU_CHECKSUM");
+  if (name != NULL && (cfg->proto.checksum = cksum_byname(name)) < 0) {
+    printf("unknown EMU_CHECKSUM \"%s\" (use sum, inet or crc32c)\n", name);
+    exit(EXIT_FAILURE);
+  }
+  name = getenv("EMU_CC");
+  if (name != NULL && (cfg->proto.cc = cc_byname(name)) < 0) {
+    printf("unknown EMU_CC \"%s\" (use none, aimd or newreno)\n", name);
+    exit(EXIT_FAILURE);
+  }
+  name = getenv("EMU_MSGSIZE");
+  if (name != NULL)
+    cfg->msgsize = (int)strtol(name, NULL, 0);
+  name = getenv("EMU_MSGDIST");
+  if (name != NULL && (cfg->msgdist = msgdist_byname(name)) < 0) {
+    printf("unknown EMU_MSGDIST \"%s\" (use fixed, uniform, exp or imix)\n", name);
+    exit(EXIT_FAILURE);
+  }
+  name = getenv("EMU_SAMPLE");
+  if (name != NULL)
+    cfg->sampleinterval = strtod(name, NULL);
+  init_links(cfg);
+}
+
+int main(void)
+{
+  struct sim_config cfg;
+  struct sim_ctx *sim;
+
+  init(&cfg);
+  sim = sim_create(&cfg);
+  if (sim == NULL)
+    return EXIT_FAILURE;
+  sim_run(sim);
+  sim_report(sim);
+  sim_destroy(sim);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "pktbuf.h"
+
+/* ******************************************************************
+   Packet buffer pool.  See pktbuf.h.
+**********************************************************************/
+
+struct pktslab {
+  struct pktslab *next;
+  struct pktbuf buf[PKTPOOL_SLAB];
+};
+
+static struct pktbuf *pktbuf_of(const struct pkt *packet)
+{
+  return (struct pktbuf *)packet;
+}
+
+void pktpool_init(struct pktpool *pool)
+{
+  memset(pool, 0, sizeof(struct pktpool));
+}
+
+struct pkt *pktpool_get(struct pktpool *pool)
+{
+  struct pktslab *slab;
+  struct pktbuf *p;
+  int i;
+
+  if (pool->freelist == NULL) {
+    slab = malloc(sizeof(struct pktslab));
+    if (slab == NULL) {
+      printf("memory allocation for packet buffers failed.");
+      exit(EXIT_FAILURE);
+    }
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->nslabs++;
+    for (i = PKTPOOL_SLAB - 1; i >= 0; i--) {
+      slab->buf[i].next = pool->freelist;
+      pool->freelist = &slab->buf[i];
+    }
+  }
+  p = pool->freelist;
+  pool->freelist = p->next;
+  memset(&p->pkt, 0, PKT_HDRSIZE);    /* the payload is length bytes */
+  p->refs = 1;
+  p->next = NULL;
+  pool->inuse++;
+  return &p->pkt;
+}
+
+void pktpool_hold(const struct pkt *packet)
+{
+  pktbuf_of(packet)->refs++;
+}
+
+void pktpool_put(struct pktpool *pool, const struct pkt *packet)
+{
+  struct pktbuf *p = pktbuf_of(packet);
+
+  if (p->refs <= 0) {
+    printf("Warning: packet buffer released more often than held\n");
+    return;
+  }
+  if (--p->refs > 0)
+    return;
+  p->next = pool->freelist;
+  pool->freelist = p;
+  pool->inuse--;
+}
+
+struct pkt *pktpool_unshare(struct pktpool *pool, const struct pkt *packet)
+{
+  struct pkt *copy;
+
+  if (pktbuf_of(packet)->refs == 1)
+    return &pktbuf_of(packet)->pkt;
+  copy = pktpool_get(pool);
+  pkt_copy(copy, packet);
+  pktpool_put(pool, packet);
+  return copy;
+}
+
+void pkt_copy(struct pkt *dst, const struct pkt *src)
+{
+  int len = src->length;
+
+  if (len < 0)
+    len = 0;
+  else if (len > MAXPAYLOAD)
+    len = MAXPAYLOAD;
+  memcpy(dst, src, PKT_HDRSIZE + len);
+}
+
+void pktpool_destroy(struct pktpool *pool)
+{
+  struct pktslab *slab, *next;
+
+  for (slab = pool->slabs; slab != NULL; slab = next) {
+    next = slab->next;
+    free(slab);
+  }
+  memset(pool, 0, sizeof(struct pktpool));
+}
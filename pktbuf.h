@@ -0,0 +1,62 @@
+/* ******************************************************************
+   Refcounted packet buffers.
+
+   tolayer3() and A_input()/B_input() take the packet by value, so every
+   hop copied it: into the arrival event, out of it for the protocol,
+   and into the protocol's window or receive buffer.  A packet buffer
+   is a struct pkt with a reference count instead, handed across the
+   layer 3/4 boundary by pointer:
+
+   - pkt_alloc() gives a new buffer holding one reference
+   - pkt_hold() takes another reference, pkt_release() drops one; the
+     buffer goes back to the pool with the last
+   - tolayer3_buf() takes over one reference of the caller: a sender
+     that keeps the packet for resending passes pkt_hold(packet)
+   - A_input_buf()/B_input_buf() lend the protocol the arriving packet
+     for the call; it takes a reference to keep it
+
+   A buffer somebody else holds may not be written: the channel may be
+   carrying it, or a receiver keeping it.  pkt_unshare() gives one that
+   may be, copying only when it is shared.  The emulator corrupts
+   packets on such a copy, so corruption never reaches the sender's
+   window.
+
+   Buffers come from a pool per simulation, refilled from slabs of
+   PKTPOOL_SLAB buffers like the event pool (sched.h); the buffers the
+   protocols and pending events still hold go with it when the
+   simulation is destroyed.
+**********************************************************************/
+#ifndef PKTBUF_H
+#define PKTBUF_H
+
+#include "emulator.h"
+
+#define PKTPOOL_SLAB 256    /* buffers allocated at a time */
+
+struct pktbuf {
+  struct pkt pkt;           /* first: a struct pkt * is its buffer */
+  int refs;
+  struct pktbuf *next;      /* in the free list */
+};
+
+struct pktslab;
+
+struct pktpool {
+  struct pktbuf *freelist;
+  struct pktslab *slabs;    /* every slab allocated so far */
+  int nslabs;
+  int inuse;                /* buffers with references */
+};
+
+extern void pktpool_init(struct pktpool *pool);
+/* a buffer holding one reference, its header zero filled */
+extern struct pkt *pktpool_get(struct pktpool *pool);
+extern void pktpool_hold(const struct pkt *packet);
+extern void pktpool_put(struct pktpool *pool, const struct pkt *packet);
+/* packet itself if the caller holds its only reference, otherwise a */
+/* copy, which the caller's reference moves to                        */
+extern struct pkt *pktpool_unshare(struct pktpool *pool, const struct pkt *packet);
+/* frees every slab, including buffers that are still held */
+extern void pktpool_destroy(struct pktpool *pool);
+
+#endif
@@ -0,0 +1,99 @@
+#include <string.h>
+#include "rng.h"
+
+/* ******************************************************************
+   Random number generators.  See rng.h.
+**********************************************************************/
+
+static uint64_t splitmix64(uint64_t *x)
+{
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/* advance a xoshiro256** state by 2^128 draws */
+static void xoshiro_jump(uint64_t *s)
+{
+  static const uint64_t jump[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                   0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+  uint64_t t[4] = { 0, 0, 0, 0 };
+  int i, b;
+
+  for (i = 0; i < 4; i++)
+    for (b = 0; b < 64; b++) {
+      if (jump[i] & (1ULL << b)) {
+        t[0] ^= s[0];
+        t[1] ^= s[1];
+        t[2] ^= s[2];
+        t[3] ^= s[3];
+      }
+      rng_xoshiro(s);
+    }
+  memcpy(s, t, sizeof(t));
+}
+
+/* glibc's srandom_r() for its default TYPE_3 state: 31 words from a */
+/* Lehmer generator, then 310 draws thrown away                      */
+static void compat_seed(struct rng *g, uint32_t seed)
+{
+  int32_t word;
+  long hi, lo;
+  int i;
+
+  if (seed == 0)
+    seed = 1;
+  g->r[0] = word = (int32_t)seed;
+  for (i = 1; i < 31; i++) {
+    /* word = (16807 * word) % 2147483647 without overflowing 31 bits */
+    hi = word / 127773;
+    lo = word % 127773;
+    word = 16807 * lo - 2836 * hi;
+    if (word < 0)
+      word += 2147483647;
+    g->r[i] = word;
+  }
+  g->front = 3;
+  g->rear = 0;
+  for (i = 0; i < 310; i++)
+    rng_compat(g);
+}
+
+void rng_seed(struct rng *g, int kind, uint32_t seed, uint32_t stream)
+{
+  uint64_t x;
+  uint32_t i;
+
+  memset(g, 0, sizeof(struct rng));
+  g->kind = kind;
+  if (kind == RNG_XOSHIRO) {
+    x = seed;
+    for (i = 0; i < 4; i++)
+      g->s[i] = splitmix64(&x);
+    for (i = 0; i < stream; i++)
+      xoshiro_jump(g->s);
+  }
+  else
+    compat_seed(g, seed + stream);
+}
+
+static const char *rng_names[] = { "compat", "xoshiro" };
+
+int rng_byname(const char *name)
+{
+  int i;
+
+  for (i = 0; i < (int)(sizeof(rng_names) / sizeof(rng_names[0])); i++)
+    if (strcmp(name, rng_names[i]) == 0)
+      return i;
+  return -1;
+}
+
+const char *rng_name(int kind)
+{
+  if (kind < 0 || kind >= (int)(sizeof(rng_names) / sizeof(rng_names[0])))
+    return "unknown";
+  return rng_names[kind];
+}
@@ -0,0 +1,82 @@
+/* ******************************************************************
+   Random number generators for the network emulator.
+
+   Every simulation owns a struct rng, so runs never share hidden
+   state and can be replayed from their seed.  Two generators:
+
+   - RNG_COMPAT   the additive feedback generator behind glibc's
+                  rand()/srand(), reimplemented so that a seed gives
+                  exactly the sequence the emulator has always drawn
+                  (srand(9999) reproduces the assignment traces)
+   - RNG_XOSHIRO  xoshiro256** (Blackman & Vigna), seeded through
+                  splitmix64.  Stream n starts n jumps of 2^128 draws
+                  into the sequence, so the streams of one seed never
+                  overlap in practice: use one stream per replication.
+**********************************************************************/
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+#define RNG_COMPAT   0
+#define RNG_XOSHIRO  1
+
+#define RNG_COMPAT_MAX 2147483647   /* RAND_MAX of the glibc generator */
+
+struct rng {
+  int kind;
+  uint64_t s[4];          /* RNG_XOSHIRO state */
+  int32_t r[31];          /* RNG_COMPAT state, r[i] = r[i-3] + r[i-31] */
+  int front, rear;        /* RNG_COMPAT positions in r */
+};
+
+/* RNG_COMPAT has no streams: stream n simply uses seed + n */
+extern void rng_seed(struct rng *g, int kind, uint32_t seed, uint32_t stream);
+
+/* map between generator names ("compat", "xoshiro") and RNG_* codes; */
+/* rng_byname returns -1 if unknown                                   */
+extern int rng_byname(const char *name);
+extern const char *rng_name(int kind);
+
+static inline uint64_t rng_rotl(uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t rng_xoshiro(uint64_t *s)
+{
+  uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rng_rotl(s[3], 45);
+  return result;
+}
+
+/* next value of the rand() sequence, in [0, RNG_COMPAT_MAX] */
+static inline int32_t rng_compat(struct rng *g)
+{
+  uint32_t val;
+
+  val = (uint32_t)g->r[g->front] + (uint32_t)g->r[g->rear];
+  g->r[g->front] = (int32_t)val;
+  if (++g->front == 31)
+    g->front = 0;
+  if (++g->rear == 31)
+    g->rear = 0;
+  return (int32_t)(val >> 1);
+}
+
+/* uniform double in [0,1] */
+static inline double rng_uniform(struct rng *g)
+{
+  if (g->kind == RNG_XOSHIRO)
+    return (rng_xoshiro(g->s) >> 11) * (1.0 / 9007199254740992.0);
+  return rng_compat(g) / (double)RNG_COMPAT_MAX;
+}
+
+#endif
@@ -0,0 +1,86 @@
+#include "rto.h"
+
+/* ******************************************************************
+   Retransmission timeout estimation.  See rto.h.
+**********************************************************************/
+
+#define RTO_ALPHA 0.125   /* gain of SRTT */
+#define RTO_BETA  0.25    /* gain of RTTVAR */
+
+static double rto_clamp(double v)
+{
+  if (v < RTO_MIN)
+    return RTO_MIN;
+  if (v > RTO_MAX)
+    return RTO_MAX;
+  return v;
+}
+
+void rto_init(struct rto *r, double initial, double ackdelay, int fixed,
+              int window)
+{
+  r->fixed = fixed;
+  r->initial = initial;
+  r->ackdelay = ackdelay;
+  r->srtt = 0.0;
+  r->rttvar = 0.0;
+  r->base = rto_clamp(initial + ackdelay);
+  r->backoff = 0;
+  r->maxbackoff = RTO_MINBACKOFF;
+  while (r->maxbackoff < RTO_MAXBACKOFF && (1 << r->maxbackoff) < window)
+    r->maxbackoff++;
+  r->nsamples = 0;
+  r->ntimeouts = 0;
+}
+
+void rto_sample(struct rto *r, double rtt)
+{
+  double err;
+
+  r->nsamples++;
+  if (r->nsamples == 1) {
+    r->srtt = rtt;
+    r->rttvar = rtt / 2;
+  }
+  else {
+    err = rtt - r->srtt;
+    r->rttvar += RTO_BETA * ((err < 0 ? -err : err) - r->rttvar);
+    r->srtt += RTO_ALPHA * err;
+  }
+  r->base = rto_clamp(r->srtt + 4 * r->rttvar + r->ackdelay);
+  r->backoff = 0;
+}
+
+void rto_timeout(struct rto *r)
+{
+  r->ntimeouts++;
+  if (r->backoff < r->maxbackoff)
+    r->backoff++;
+}
+
+void rto_progress(struct rto *r)
+{
+  if (r->nsamples > 0)
+    r->backoff = 0;
+}
+
+double rto_get(const struct rto *r)
+{
+  return rto_backoff(r, r->backoff);
+}
+
+double rto_backoff(const struct rto *r, int shift)
+{
+  if (r->fixed)
+    return r->initial;
+  return rto_clamp(r->base * (1 << shift));
+}
+
+void rto_stats(const struct rto *r, struct sim_stats *st)
+{
+  st->rtt_samples = r->nsamples;
+  st->timeouts = r->ntimeouts;
+  st->srtt = r->srtt;
+  st->rttvar = r->rttvar;
+  st->rto = rto_get(r);
+}
@@ -0,0 +1,72 @@
+/* ******************************************************************
+   Retransmission timeout of a sender.
+
+   The adaptive mode follows RFC 6298: round trip samples feed the
+   smoothed RTT and its mean deviation (Jacobson/Karels), the timeout
+   is SRTT + 4 RTTVAR, and every expiry doubles it.  Senders must only
+   take samples from packets that were sent once (Karn's rule), since
+   the ACK of a resent packet cannot be matched to a transmission; the
+   backoff is dropped again on a sample or as soon as a resent packet
+   gets through, so one unlucky packet does not slow the whole transfer
+   down until the next clean sample.  Before the first sample the
+   initial timeout is only a guess, though: if the round trip is longer
+   every packet times out, is resent and cannot be measured, so the
+   backoff is only dropped on progress once there is an estimate.
+
+   A receiver that delays its ACKs may hold one back for up to its ACK
+   delay on top of the round trip, so that delay is added to the
+   timeout, as QUIC adds max_ack_delay (RFC 9002).  Without it a sample
+   taken on a promptly ACKed packet can set a timeout shorter than the
+   next delayed ACK, and every packet after it is resent.
+
+   Every expiry doubles the timeout up to RTO_MAX, but only as often
+   as the window needs.  A packet can only queue up behind the rest of
+   its window, so a window of n packets stops doubling once the timeout
+   is at least n times the estimate, and no earlier than 2^RTO_MINBACKOFF
+   times it; the largest windows can reach RTO_MAX.  More than half of
+   the transmissions can fail on the assignment's lossy channels, and
+   a backoff without a limit would then wait longer for every packet.
+
+   The fixed mode always answers the initial timeout, the constant RTT
+   the assignment prescribes; the estimates are still kept for the
+   statistics.
+**********************************************************************/
+#ifndef RTO_H
+#define RTO_H
+
+#include "emulator.h"
+
+#define RTO_MIN   2.0     /* the shortest possible round trip */
+#define RTO_MAX   65536.0 /* full large windows queue up long round trips */
+#define RTO_MINBACKOFF 3  /* every window backs off at least 2^3 times */
+#define RTO_MAXBACKOFF 16 /* for MAXWINDOW, 2^16 RTO_MIN is past RTO_MAX */
+
+struct rto {
+  int fixed;              /* always time out after initial */
+  double initial;
+  double srtt, rttvar;
+  double ackdelay;        /* longest the receiver holds an ACK back */
+  double base;            /* SRTT + 4 RTTVAR + ackdelay, before backoff */
+  int backoff;            /* timeouts since the last sample or progress */
+  int maxbackoff;         /* at most, for the window */
+  int nsamples;
+  int ntimeouts;
+};
+
+/* for a sender with a window of window packets */
+extern void rto_init(struct rto *r, double initial, double ackdelay, int fixed,
+                     int window);
+/* a round trip time measured on a packet sent only once */
+extern void rto_sample(struct rto *r, double rtt);
+/* the retransmission timer went off */
+extern void rto_timeout(struct rto *r);
+/* new data was acknowledged, even if only by a resent packet */
+/* (this keeps the backoff while there is no estimate yet)     */
+extern void rto_progress(struct rto *r);
+extern double rto_get(const struct rto *r);
+/* the estimate backed off shift times, for per-packet backoff */
+extern double rto_backoff(const struct rto *r, int shift);
+/* publish the estimator in the simulation's statistics */
+extern void rto_stats(const struct rto *r, struct sim_stats *st);
+
+#endif
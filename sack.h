@@ -0,0 +1,71 @@
+/* ******************************************************************
+   Selective acknowledgements (after RFC 2018), carried in the payload
+   of ACK-only packets, which has no other use.
+
+   A SACK tells the sender which packets the receiver holds beyond the
+   first one it is missing, so that only the holes are resent.  The
+   payload keeps to printable characters, as traces print it: each
+   character holds SACK_CHARBITS bits as '0' + value.  The first
+   SACK_BASECHARS characters hold the first missing sequence number,
+   the base; bit i of the rest tells whether packet base + 1 + i is
+   buffered.  Packets further out are not reported, and are resent
+   like without SACK.  An ACK-only packet with PKT_SACK set carries one
+   in a payload of SACK_SIZE bytes.
+**********************************************************************/
+#ifndef SACK_H
+#define SACK_H
+
+#include <stdint.h>
+#include "seqnum.h"
+
+#define SACK_SIZE      20
+#define SACK_CHARBITS  6
+#define SACK_BASECHARS 6      /* 36 bits, for a 32 bit sequence number */
+#define SACK_BITS      ((SACK_SIZE - SACK_BASECHARS) * SACK_CHARBITS)
+
+/* fill payload with the SACK of a receiver expecting base next, whose */
+/* received bitmap over a ring of mask + 1 slots (seqnum.h) marks the  */
+/* packets buffered in its receive window of window packets            */
+static inline void sack_encode(char *payload, uint32_t base,
+                               const uint64_t *received, uint32_t mask, uint32_t window)
+{
+  int v[SACK_SIZE] = {0};
+  uint32_t i, n;
+
+  for (i = 0; i < SACK_BASECHARS; i++)
+    v[i] = (base >> (i * SACK_CHARBITS)) & ((1 << SACK_CHARBITS) - 1);
+  n = window - 1 < SACK_BITS ? window - 1 : SACK_BITS;
+  for (i = 0; i < n; i++)
+    if (bitmap_test(received, (base + 1 + i) & mask))
+      v[SACK_BASECHARS + i / SACK_CHARBITS] |= 1 << (i % SACK_CHARBITS);
+  for (i = 0; i < SACK_SIZE; i++)
+    payload[i] = (char)('0' + v[i]);
+}
+
+/* the first sequence number the receiver is missing */
+static inline uint32_t sack_base(const char *payload)
+{
+  uint32_t base = 0;
+  int i;
+
+  for (i = SACK_BASECHARS - 1; i >= 0; i--)
+    base = (base << SACK_CHARBITS) | (uint32_t)(payload[i] - '0');
+  return base;
+}
+
+/* whether the receiver holds packet seq; every packet before the base */
+/* counts as received                                                 */
+static inline int sack_test(const char *payload, uint32_t seq)
+{
+  uint32_t base = sack_base(payload);
+  uint32_t i;
+
+  if (seq_lt(seq, base))
+    return 1;
+  if (seq == base || seq_dist(base, seq) > SACK_BITS)
+    return 0;
+  i = seq_dist(base, seq) - 1;
+  return ((payload[SACK_BASECHARS + i / SACK_CHARBITS] - '0') >> (i % SACK_CHARBITS)) & 1;
+}
+
+#endif
@@ -0,0 +1,467 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "sched.h"
+
+/* ******************************************************************
+   Pending-event scheduler.  See sched.h for an overview.
+**********************************************************************/
+
+#define CAL_MINBUCKETS 16   /* calendar never shrinks below this */
+#define CAL_SAMPLE     25   /* events sampled to choose a bucket width */
+
+/* true if a must run before b.  Events with equal evtime run newest */
+/* first, not first in first out: the old list put a new event in    */
+/* front of those with the same time, and every scheduler pops what  */
+/* it popped so that runs print the same output.  Comparing evseq    */
+/* the other way round would give FIFO ties                          */
+static int before(const struct event *a, const struct event *b)
+{
+  if (a->evtime != b->evtime)
+    return a->evtime < b->evtime;
+  return a->evseq > b->evseq;
+}
+
+static void *sched_alloc(size_t size)
+{
+  void *p = malloc(size);
+
+  if (p == NULL) {
+    printf("memory allocation for event scheduler failed.");
+    exit(EXIT_FAILURE);
+  }
+  return p;
+}
+
+
+/********************** sorted list **********************/
+
+static void list_insert(struct event **head, struct event *p)
+{
+  struct event *q, *qold;
+
+  q = *head;
+  if (q == NULL) {   /* list is empty */
+    *head = p;
+    p->next = NULL;
+    p->prev = NULL;
+    return;
+  }
+  for (qold = q; q != NULL && before(q, p); q = q->next)
+    qold = q;
+  if (q == NULL) {   /* end of list */
+    qold->next = p;
+    p->prev = qold;
+    p->next = NULL;
+  }
+  else if (q == *head) { /* front of list */
+    p->next = *head;
+    p->prev = NULL;
+    p->next->prev = p;
+    *head = p;
+  }
+  else {     /* middle of list */
+    p->next = q;
+    p->prev = q->prev;
+    q->prev->next = p;
+    q->prev = p;
+  }
+}
+
+static void list_unlink(struct event **head, struct event *p)
+{
+  if (p->prev != NULL)
+    p->prev->next = p->next;
+  else
+    *head = p->next;
+  if (p->next != NULL)
+    p->next->prev = p->prev;
+  p->next = NULL;
+  p->prev = NULL;
+}
+
+
+/********************** d-ary heap **********************/
+
+static void heap_place(struct sched *s, struct event *p, int i)
+{
+  s->heap[i] = p;
+  p->evslot = i;
+}
+
+static void heap_siftup(struct sched *s, int i)
+{
+  struct event *p = s->heap[i];
+  int parent;
+
+  while (i > 0) {
+    parent = (i - 1) / s->arity;
+    if (!before(p, s->heap[parent]))
+      break;
+    heap_place(s, s->heap[parent], i);
+    i = parent;
+  }
+  heap_place(s, p, i);
+}
+
+static void heap_siftdown(struct sched *s, int i)
+{
+  struct event *p = s->heap[i];
+  int child, best, last;
+
+  for (;;) {
+    child = s->arity * i + 1;
+    if (child >= s->count)
+      break;
+    last = child + s->arity;
+    if (last > s->count)
+      last = s->count;
+    for (best = child++; child < last; child++)
+      if (before(s->heap[child], s->heap[best]))
+        best = child;
+    if (!before(s->heap[best], p))
+      break;
+    heap_place(s, s->heap[best], i);
+    i = best;
+  }
+  heap_place(s, p, i);
+}
+
+static void heap_insert(struct sched *s, struct event *p)
+{
+  struct event **grown;
+
+  if (s->count == s->heapsize) {
+    s->heapsize = s->heapsize ? 2 * s->heapsize : 64;
+    grown = realloc(s->heap, s->heapsize * sizeof(struct event *));
+    if (grown == NULL) {
+      printf("memory allocation for event scheduler failed.");
+      exit(EXIT_FAILURE);
+    }
+    s->heap = grown;
+  }
+  s->heap[s->count] = p;
+  p->evslot = s->count++;
+  heap_siftup(s, p->evslot);
+}
+
+static void heap_remove(struct sched *s, struct event *p)
+{
+  int i = p->evslot;
+  struct event *last = s->heap[--s->count];
+
+  if (last == p)
+    return;
+  heap_place(s, last, i);
+  if (i > 0 && before(last, s->heap[(i - 1) / s->arity]))
+    heap_siftup(s, i);
+  else
+    heap_siftdown(s, i);
+}
+
+
+/********************** calendar queue **********************/
+
+/* unwrapped bucket number of time t */
+static long long cal_vbucket(const struct sched *s, double t)
+{
+  return (long long)floor(t / s->width);
+}
+
+static void cal_insert(struct sched *s, struct event *p)
+{
+  long long vb = cal_vbucket(s, p->evtime);
+  int i = (int)(vb & (s->nbuckets - 1));
+
+  p->evslot = i;
+  list_insert(&s->bucket[i], p);
+  if (s->count == 0 || vb < s->curbucket)
+    s->curbucket = vb;
+  s->count++;
+}
+
+/* earliest event, leaving curbucket at its bucket */
+static struct event *cal_first(struct sched *s)
+{
+  struct event *p, *best;
+  long long vb;
+  int i, k;
+
+  if (s->count == 0)
+    return NULL;
+  /* look for an event in the current "year" of each bucket */
+  best = NULL;
+  for (k = 0; k < s->nbuckets; k++) {
+    vb = s->curbucket + k;
+    p = s->bucket[vb & (s->nbuckets - 1)];
+    if (p != NULL && cal_vbucket(s, p->evtime) <= vb) {
+      best = p;
+      s->curbucket = vb;
+      break;
+    }
+  }
+  /* nothing within a year: fall back to a direct search */
+  if (best == NULL) {
+    for (i = 0; i < s->nbuckets; i++)
+      if (s->bucket[i] != NULL && (best == NULL || before(s->bucket[i], best)))
+        best = s->bucket[i];
+    s->curbucket = cal_vbucket(s, best->evtime);
+  }
+  return best;
+}
+
+static struct event *cal_dequeue(struct sched *s)
+{
+  struct event *best = cal_first(s);
+
+  if (best == NULL)
+    return NULL;
+  list_unlink(&s->bucket[best->evslot], best);
+  s->count--;
+  return best;
+}
+
+/* rebuild the calendar with nbuckets buckets and a width chosen from */
+/* the spacing of the events at the front of the queue               */
+static void cal_resize(struct sched *s, int nbuckets)
+{
+  struct event *sample[CAL_SAMPLE];
+  struct event **old, *p, *pnext;
+  int oldn, n, i, gaps;
+  double avg, sum, gap;
+
+  s->resizing = 1;
+  n = s->count < CAL_SAMPLE ? s->count : CAL_SAMPLE;
+  for (i = 0; i < n; i++)
+    sample[i] = cal_dequeue(s);
+  if (n > 1) {
+    avg = (sample[n-1]->evtime - sample[0]->evtime) / (n - 1);
+    sum = 0.0;
+    gaps = 0;
+    for (i = 1; i < n; i++) {
+      gap = sample[i]->evtime - sample[i-1]->evtime;
+      if (gap <= 2.0 * avg) {
+        sum += gap;
+        gaps++;
+      }
+    }
+    if (gaps > 0 && sum > 0.0)
+      s->width = 3.0 * sum / gaps;
+  }
+  for (i = 0; i < n; i++)
+    cal_insert(s, sample[i]);
+
+  old = s->bucket;
+  oldn = s->nbuckets;
+  s->bucket = sched_alloc(nbuckets * sizeof(struct event *));
+  memset(s->bucket, 0, nbuckets * sizeof(struct event *));
+  s->nbuckets = nbuckets;
+  s->count = 0;
+  for (i = 0; i < oldn; i++)
+    for (p = old[i]; p != NULL; p = pnext) {
+      pnext = p->next;
+      cal_insert(s, p);
+    }
+  free(old);
+  s->resizing = 0;
+}
+
+
+/********************** public interface **********************/
+
+void sched_init(struct sched *s, int kind)
+{
+  memset(s, 0, sizeof(struct sched));
+  s->kind = kind;
+  if (kind == SCHED_HEAP2)
+    s->arity = 2;
+  else if (kind == SCHED_HEAP4)
+    s->arity = 4;
+  else if (kind == SCHED_CALENDAR) {
+    s->nbuckets = CAL_MINBUCKETS;
+    s->width = 1.0;
+    s->bucket = sched_alloc(s->nbuckets * sizeof(struct event *));
+    memset(s->bucket, 0, s->nbuckets * sizeof(struct event *));
+  }
+}
+
+/* release the scheduler's own storage; pending events belong to the caller */
+void sched_destroy(struct sched *s)
+{
+  free(s->heap);
+  free(s->bucket);
+  memset(s, 0, sizeof(struct sched));
+}
+
+void sched_insert(struct sched *s, struct event *p)
+{
+  p->evseq = s->nextseq++;
+  switch (s->kind) {
+  case SCHED_HEAP2:
+  case SCHED_HEAP4:
+    heap_insert(s, p);
+    break;
+  case SCHED_CALENDAR:
+    cal_insert(s, p);
+    if (!s->resizing && s->count > 2 * s->nbuckets)
+      cal_resize(s, 2 * s->nbuckets);
+    break;
+  default:
+    list_insert(&s->head, p);
+    s->count++;
+  }
+}
+
+/* remove and return the earliest event, NULL if there is none */
+struct event *sched_pop(struct sched *s)
+{
+  struct event *p;
+
+  if (s->count == 0)
+    return NULL;
+  switch (s->kind) {
+  case SCHED_HEAP2:
+  case SCHED_HEAP4:
+    p = s->heap[0];
+    heap_remove(s, p);
+    break;
+  case SCHED_CALENDAR:
+    p = cal_dequeue(s);
+    if (!s->resizing && s->nbuckets > CAL_MINBUCKETS && s->count < s->nbuckets / 2)
+      cal_resize(s, s->nbuckets / 2);
+    break;
+  default:
+    p = s->head;
+    list_unlink(&s->head, p);
+    s->count--;
+  }
+  return p;
+}
+
+/* the earliest event, left in the schedule; NULL if there is none */
+struct event *sched_peek(struct sched *s)
+{
+  if (s->count == 0)
+    return NULL;
+  switch (s->kind) {
+  case SCHED_HEAP2:
+  case SCHED_HEAP4:
+    return s->heap[0];
+  case SCHED_CALENDAR:
+    return cal_first(s);
+  default:
+    return s->head;
+  }
+}
+
+/* remove a pending event from anywhere in the schedule */
+void sched_remove(struct sched *s, struct event *p)
+{
+  switch (s->kind) {
+  case SCHED_HEAP2:
+  case SCHED_HEAP4:
+    heap_remove(s, p);
+    break;
+  case SCHED_CALENDAR:
+    list_unlink(&s->bucket[p->evslot], p);
+    s->count--;
+    break;
+  default:
+    list_unlink(&s->head, p);
+    s->count--;
+  }
+}
+
+struct event *sched_next(struct sched *s, struct event *q)
+{
+  int i;
+
+  switch (s->kind) {
+  case SCHED_HEAP2:
+  case SCHED_HEAP4:
+    i = (q == NULL) ? 0 : q->evslot + 1;
+    return (i < s->count) ? s->heap[i] : NULL;
+  case SCHED_CALENDAR:
+    if (q != NULL && q->next != NULL)
+      return q->next;
+    for (i = (q == NULL) ? 0 : q->evslot + 1; i < s->nbuckets; i++)
+      if (s->bucket[i] != NULL)
+        return s->bucket[i];
+    return NULL;
+  default:
+    return (q == NULL) ? s->head : q->next;
+  }
+}
+
+static const char *sched_names[] = { "list", "heap", "heap4", "calendar" };
+
+int sched_byname(const char *name)
+{
+  int i;
+
+  for (i = 0; i < (int)(sizeof(sched_names) / sizeof(sched_names[0])); i++)
+    if (strcmp(name, sched_names[i]) == 0)
+      return i;
+  return -1;
+}
+
+const char *sched_name(int kind)
+{
+  if (kind < 0 || kind >= (int)(sizeof(sched_names) / sizeof(sched_names[0])))
+    return "unknown";
+  return sched_names[kind];
+}
+
+
+/********************** event pool **********************/
+
+struct evslab {
+  struct evslab *next;
+  struct event ev[EVPOOL_SLAB];
+};
+
+void evpool_init(struct evpool *pool)
+{
+  memset(pool, 0, sizeof(struct evpool));
+}
+
+struct event *evpool_get(struct evpool *pool)
+{
+  struct evslab *slab;
+  struct event *p;
+  int i;
+
+  if (pool->freelist == NULL) {
+    slab = sched_alloc(sizeof(struct evslab));
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->nslabs++;
+    for (i = EVPOOL_SLAB - 1; i >= 0; i--) {
+      slab->ev[i].next = pool->freelist;
+      pool->freelist = &slab->ev[i];
+    }
+  }
+  p = pool->freelist;
+  pool->freelist = p->next;
+  p->next = NULL;
+  p->prev = NULL;
+  return p;
+}
+
+void evpool_put(struct evpool *pool, struct event *p)
+{
+  p->next = pool->freelist;
+  pool->freelist = p;
+}
+
+void evpool_destroy(struct evpool *pool)
+{
+  struct evslab *slab, *next;
+
+  for (slab = pool->slabs; slab != NULL; slab = next) {
+    next = slab->next;
+    free(slab);
+  }
+  memset(pool, 0, sizeof(struct evpool));
+}
@@ -0,0 +1,105 @@
+/* ******************************************************************
+   Pending-event scheduler for the network emulator.
+
+   The emulator used to keep its future events in a sorted doubly-linked
+   list, which made every insertion O(pending events).  The routines
+   below hide the event set behind one interface with several
+   interchangeable implementations:
+
+   - SCHED_LIST      the original sorted list (O(n) insert, O(1) pop)
+   - SCHED_HEAP2     binary heap (O(log n) insert/pop)
+   - SCHED_HEAP4     4-ary heap, shallower and more cache friendly
+   - SCHED_CALENDAR  calendar queue (Brown 1988), O(1) expected
+
+   All implementations order events by (evtime, insertion stamp) and
+   pop exactly the same sequence as the original list: among events
+   with equal evtime the most recently inserted one runs first, since
+   insertevent() used to place a new event in front of any event with
+   the same time.
+
+   Events themselves come from an evpool: a free list refilled from
+   slabs of EVPOOL_SLAB events, so that scheduling and retiring events
+   in the main loop does no heap allocation once the pool is warm.
+**********************************************************************/
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "emulator.h"
+
+struct event {
+  float evtime;           /* event time */
+  int evtype;             /* event type code */
+  int eventity;           /* entity where event occurs */
+  const struct pkt *pkt;  /* packet (if any) assoc w/ this event, a */
+                          /* reference to its buffer (pktbuf.h)     */
+  unsigned long evseq;    /* insertion stamp, breaks ties on evtime */
+  int evslot;             /* heap index or calendar bucket of this event */
+  struct event *prev;
+  struct event *next;
+};
+
+/* scheduler implementations */
+#define SCHED_LIST      0
+#define SCHED_HEAP2     1
+#define SCHED_HEAP4     2
+#define SCHED_CALENDAR  3
+
+/* compile-time default, override with -DSCHED_DEFAULT=... */
+#ifndef SCHED_DEFAULT
+#define SCHED_DEFAULT SCHED_HEAP4
+#endif
+
+struct sched {
+  int kind;               /* which implementation is in use */
+  int count;              /* number of pending events */
+  unsigned long nextseq;  /* next insertion stamp */
+
+  /* SCHED_LIST */
+  struct event *head;
+
+  /* SCHED_HEAP2 / SCHED_HEAP4 */
+  struct event **heap;
+  int heapsize;           /* allocated slots in heap */
+  int arity;
+
+  /* SCHED_CALENDAR */
+  struct event **bucket;  /* nbuckets sorted lists */
+  int nbuckets;           /* always a power of two */
+  double width;           /* time covered by one bucket */
+  long long curbucket;    /* virtual (unwrapped) bucket being drained */
+  int resizing;           /* set while sampling for a new width */
+};
+
+extern void sched_init(struct sched *s, int kind);
+extern void sched_destroy(struct sched *s);
+extern void sched_insert(struct sched *s, struct event *p);
+extern struct event *sched_pop(struct sched *s);
+extern struct event *sched_peek(struct sched *s);
+extern void sched_remove(struct sched *s, struct event *p);
+
+/* iterate over pending events (in time order only for SCHED_LIST):
+   for (q = sched_next(s, NULL); q != NULL; q = sched_next(s, q)) */
+extern struct event *sched_next(struct sched *s, struct event *q);
+
+/* map between implementation names ("list", "heap", "heap4",
+   "calendar") and SCHED_* codes; sched_byname returns -1 if unknown */
+extern int sched_byname(const char *name);
+extern const char *sched_name(int kind);
+
+#define EVPOOL_SLAB 256     /* events allocated at a time */
+
+struct evslab;
+
+struct evpool {
+  struct event *freelist;  /* events ready for reuse, linked by next */
+  struct evslab *slabs;    /* every slab allocated so far */
+  int nslabs;
+};
+
+extern void evpool_init(struct evpool *pool);
+extern struct event *evpool_get(struct evpool *pool);
+extern void evpool_put(struct evpool *pool, struct event *p);
+/* frees every slab, including events that are still scheduled */
+extern void evpool_destroy(struct evpool *pool);
+
+#endif
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <string.h>
+#include "sendq.h"
+#include "seqnum.h"
+
+/* ******************************************************************
+   Send queue.  See sendq.h.
+**********************************************************************/
+
+void sendq_init(struct sendq *q, int entity, int capacity,
+                void (*backpressure)(int entity, int blocked))
+{
+  if (capacity > SENDQ_MAX) {
+    printf("Warning: send queue of %d messages too large, using %d\n", capacity, SENDQ_MAX);
+    capacity = SENDQ_MAX;
+  }
+  q->capacity = capacity > 0 ? capacity : 0;
+  q->first = 0;
+  q->count = 0;
+  q->entity = entity;
+  q->blocked = 0;
+  q->backpressure = backpressure;
+  q->mask = ring_size(q->capacity) - 1;
+  q->msg = NULL;
+  q->stamp = NULL;
+  if (q->capacity > 0) {
+    q->msg = sim_alloc((q->mask + 1) * sizeof(struct msg));
+    q->stamp = sim_alloc((q->mask + 1) * sizeof(double));
+  }
+}
+
+static void msg_copy(struct msg *dst, const struct msg *src)
+{
+  dst->length = src->length;
+  memcpy(dst->data, src->data, src->length);
+}
+
+int sendq_push(struct sendq *q, const struct msg *m)
+{
+  int i;
+
+  if (q->count == q->capacity)
+    return 0;
+  i = (q->first + q->count) & q->mask;
+  msg_copy(&q->msg[i], m);
+  q->stamp[i] = sim_time();
+  q->count++;
+  sim_queue(q->entity, q->count);
+  if (q->count == q->capacity && q->backpressure != NULL) {
+    q->blocked = 1;
+    q->backpressure(q->entity, 1);
+  }
+  return 1;
+}
+
+int sendq_pop(struct sendq *q, struct msg *m)
+{
+  if (q->count == 0)
+    return 0;
+  msg_copy(m, &q->msg[q->first]);
+  sim_queuedelay(sim_time() - q->stamp[q->first]);
+  q->first = (q->first + 1) & q->mask;
+  q->count--;
+  sim_queue(q->entity, q->count);
+  if (q->blocked) {
+    q->blocked = 0;
+    q->backpressure(q->entity, 0);
+  }
+  return 1;
+}
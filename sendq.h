@@ -0,0 +1,42 @@
+/* ******************************************************************
+   Send queue of a sender: messages layer 5 handed down while the
+   send window was full, oldest first.
+
+   The queue is a ring of at least capacity slots, and at most
+   SENDQ_MAX, allocated with the simulation; only the bytes a message
+   uses are copied in and out of its slot.  The sender pushes a
+   message when its window is full and pops messages whenever ACKs
+   open the window again.  When the queue fills up it calls its
+   backpressure callback with blocked set, and again with blocked
+   clear once a message has left, so that layer 5 can stop handing
+   down messages instead of losing them.  The queue
+   reports its depth and the time every message waited to the
+   emulator (sim_queue, sim_queuedelay).
+**********************************************************************/
+#ifndef SENDQ_H
+#define SENDQ_H
+
+#include "emulator.h"
+
+#define SENDQ_MAX 1024    /* largest capacity, a power of two */
+
+struct sendq {
+  int capacity;           /* 0: no queue, messages are refused */
+  int first, count;
+  int entity;             /* sender, passed to the callback */
+  int blocked;            /* full, and the callback was told so */
+  void (*backpressure)(int entity, int blocked);
+  int mask;               /* ring slots - 1 */
+  struct msg *msg;
+  double *stamp;          /* when each message was queued */
+};
+
+/* capacity is clamped to SENDQ_MAX; backpressure may be NULL */
+extern void sendq_init(struct sendq *q, int entity, int capacity,
+                       void (*backpressure)(int entity, int blocked));
+/* queue m, 0 if the queue is full */
+extern int sendq_push(struct sendq *q, const struct msg *m);
+/* take the oldest message, 0 if the queue is empty */
+extern int sendq_pop(struct sendq *q, struct msg *m);
+
+#endif
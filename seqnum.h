@@ -0,0 +1,65 @@
+/* ******************************************************************
+   Sequence numbers and the per-packet state of a window.
+
+   Sequence numbers are 32 bits wide and wrap around.  They are
+   compared with serial number arithmetic (RFC 1982): a comes before b
+   if b is less than 2^31 ahead of it.  That holds as long as the
+   numbers in play are less than 2^31 apart, which any window far
+   below that size guarantees.
+
+   A window keeps its per-packet state in rings of a power of two
+   slots, at least the window size, indexed by seq & mask: the slot
+   of a sequence number is the same whichever way round it wrapped.
+   Flags (acked, received, resent) are bitmaps over such a ring.
+**********************************************************************/
+#ifndef SEQNUM_H
+#define SEQNUM_H
+
+#include <stdint.h>
+
+/* a comes before b */
+static inline int seq_lt(uint32_t a, uint32_t b)
+{
+  return (int32_t)(a - b) < 0;
+}
+
+static inline int seq_le(uint32_t a, uint32_t b)
+{
+  return (int32_t)(a - b) <= 0;
+}
+
+/* how far b is past a, for a before or equal to b */
+static inline uint32_t seq_dist(uint32_t a, uint32_t b)
+{
+  return b - a;
+}
+
+/* slots of a ring that holds a window of n packets */
+static inline uint32_t ring_size(uint32_t n)
+{
+  uint32_t size = 1;
+
+  while (size < n)
+    size <<= 1;
+  return size;
+}
+
+/* words of a bitmap over a ring of size slots */
+#define BITMAP_WORDS(size) (((size) + 63) / 64)
+
+static inline int bitmap_test(const uint64_t *map, uint32_t i)
+{
+  return (map[i / 64] >> (i % 64)) & 1;
+}
+
+static inline void bitmap_set(uint64_t *map, uint32_t i)
+{
+  map[i / 64] |= (uint64_t)1 << (i % 64);
+}
+
+static inline void bitmap_clear(uint64_t *map, uint32_t i)
+{
+  map[i / 64] &= ~((uint64_t)1 << (i % 64));
+}
+
+#endif
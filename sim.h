@@ -0,0 +1,182 @@
+/* ******************************************************************
+   Simulation contexts.
+
+   All state of one emulated network - event schedule, clock, channel,
+   random number generator, statistics and the protocol's own state -
+   lives in a struct sim_ctx, so any number of simulations can be set
+   up and run in one process:
+
+     struct sim_config cfg;
+     struct sim_ctx *sim;
+
+     sim_defaults(&cfg);
+     cfg.lossprob = 0.1;
+     sim = sim_create(&cfg);
+     sim_run(sim);
+     ... sim->stats ...
+     sim_destroy(sim);
+
+   While a simulation is being created or run it is the current one of
+   the calling thread; that is the one the student-callable routines
+   (tolayer3, starttimer, ...) and sim_stats() act on.  Different
+   threads may run different simulations at the same time.
+**********************************************************************/
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdlib.h>
+#include "emulator.h"
+#include "sched.h"
+#include "channel.h"
+#include "rng.h"
+#include "transport.h"
+#include "trace.h"
+#include "hist.h"
+#include "wheel.h"
+#include "pktbuf.h"
+
+/* parameters of a run, what init() used to read from stdin */
+struct sim_config {
+  const struct transport_ops *transport; /* protocol run at A and B */
+  int nsimmax;            /* number of msgs to generate, then stop */
+  float lossprob;         /* probability that a packet is dropped  */
+  float corruptprob;      /* probability that one bit is packet is flipped */
+  int corruptdirection;   /* A->B A<-B or bidirectional corruption/loss */
+  float lambda;           /* arrival rate of messages from layer 5 */
+  int msgsize;            /* mean message size in bytes, 0 for MSGSIZE */
+  int msgdist;            /* distribution of message sizes, MSGDIST_* */
+  int trace;              /* TRACE level while this simulation runs */
+  const char *tracefile;  /* write trace records here instead of stdout */
+  unsigned int tracesize; /* records kept in tracefile, 0 for TRACE_NREC */
+  float sampleinterval;   /* sample the run this often, 0 for never */
+  int backpressure;       /* layer 5 waits while the send queue is full */
+  int sched;              /* event scheduler, SCHED_* in sched.h */
+  int rng;                /* random number generator, RNG_* in rng.h */
+  unsigned int seed;      /* random number generator seed */
+  unsigned int stream;    /* independent stream of that seed */
+  struct link_config link[2]; /* the A->B and B->A links, by sender */
+  struct proto_config proto; /* handed to the protocol */
+};
+
+#define SIM_SEED 9999     /* the seed the emulator has always used */
+
+/* message size distributions, of mean sim_config.msgsize and at most */
+/* MAXPAYLOAD bytes                                                    */
+#define MSGDIST_FIXED    0  /* every message msgsize bytes */
+#define MSGDIST_UNIFORM  1  /* uniform in 1 .. 2 msgsize - 1 */
+#define MSGDIST_EXP      2  /* 1 + exponential of mean msgsize - 1 */
+#define MSGDIST_IMIX     3  /* simple IMIX: 40, 576 and 1500 bytes in */
+                            /* the ratio 7:4:1, whatever msgsize       */
+
+/* map between distribution names ("fixed", "uniform", "exp", "imix") */
+/* and MSGDIST_* codes; msgdist_byname returns -1 if unknown          */
+extern int msgdist_byname(const char *name);
+extern const char *msgdist_name(int kind);
+
+/* layer 5 entry times of the messages a sender has accepted and not */
+/* yet delivered at the other side, oldest first                     */
+struct msgstamps {
+  float *t;
+  int first, count, size;   /* size is a power of two */
+};
+
+/* state of the run every sampleinterval time units */
+struct sim_sample {
+  float time;
+  int window;             /* packets in A's send window */
+  float rto;              /* A's retransmission timeout */
+  int delivered;          /* messages delivered so far */
+  int queue;              /* messages in A's send queue */
+  int linkq;              /* packets in the queue of the A->B link */
+  float cwnd, ssthresh;   /* A's congestion window and threshold */
+};
+
+/* figures of merit of a run, see sim_metrics() */
+struct sim_metrics {
+  unsigned long long nlatency; /* messages whose latency was measured */
+  double latency_mean;    /* A_output() to tolayer5(), in time units */
+  double latency_p50, latency_p99, latency_p999, latency_max;
+  double goodput;         /* messages delivered per time unit */
+  double byte_goodput;    /* message bytes delivered per time unit */
+  double header_overhead; /* header bytes per byte sent into layer 3 */
+  double retransmit_ratio; /* resends per message A accepted */
+  double ack_ratio;       /* ACKs sent, alone or on data, per packet */
+                          /* received                                 */
+  double window_mean;     /* time average of A's send window occupancy */
+  int window_max;
+  double queue_mean;      /* time average of A's send queue occupancy */
+  int queue_max;
+  unsigned long long nqueuedelay; /* messages that waited in the queue */
+  double queuedelay_mean; /* how long they waited */
+  double queuedelay_p99, queuedelay_max;
+  double blocked_time;    /* time the send queue was full */
+  double link_util[2];    /* of the A->B and B->A links with a */
+  double linkq_mean[2];   /* bandwidth: the time they were sending */
+  int linkq_max[2];       /* and the packets in their queues        */
+  double loss_burst_mean; /* packets the links lost per run of losses */
+  double cwnd_mean;       /* time average of A's congestion window */
+};
+
+struct sim_ctx {
+  struct sim_config cfg;
+  struct sim_stats stats;
+
+  struct sched evlist;    /* the pending events, see sched.h */
+  struct evpool evpool;   /* storage for events */
+  struct pktpool pktpool; /* and for packets, see pktbuf.h */
+  struct event *timerevent[2]; /* pending timer of A and B, or NULL */
+  struct wheel timers;    /* logical timers of A and B */
+  struct wheel_timer **idtimer[2]; /* by id, allocated on first use */
+  int nidtimer[2];
+  struct link links[2];   /* the A->B and B->A links, by sender */
+
+  float time;
+  int nsim;               /* number of messages from 5 to 4 so far */
+
+  struct rng rng;         /* private random number stream */
+  struct rng msgrng;      /* message sizes, drawn apart so that the */
+                          /* distribution leaves the losses alone    */
+  struct trace_ring *trace; /* binary trace, NULL to print trace text */
+
+  struct msgstamps stamps[2]; /* messages in transit, by sender */
+  struct hist latency;    /* delivery latency of every message */
+  int window;             /* A's send window occupancy, see sim_window() */
+  float window_since;     /* time of its last change */
+  double window_area;     /* its integral over time up to then */
+  int window_max;
+  double cwnd;            /* A's congestion window, see sim_cwnd() */
+  float cwnd_since;
+  double cwnd_area;
+  int queue;              /* A's send queue occupancy, see sim_queue() */
+  float queue_since;
+  double queue_area;
+  int queue_max;
+  struct hist queuedelay; /* time messages waited in the send queue */
+  int blocked[2];         /* send queue full, see sim_backpressure() */
+  int held[2];            /* layer 5 holds a message until it drains */
+  float blocked_since[2];
+  double blocked_time;
+  struct sim_sample *samples;
+  int nsamples, samplesize;
+  float nextsample;
+
+  void *proto;            /* protocol state, see sim_protostate() */
+  void **blocks;          /* from sim_alloc() */
+  int nblocks, blocksize;
+};
+
+extern void sim_defaults(struct sim_config *cfg);
+/* NULL if the random number generator looks broken */
+extern struct sim_ctx *sim_create(const struct sim_config *cfg);
+/* run until no events are left */
+extern void sim_run(struct sim_ctx *sim);
+extern void sim_destroy(struct sim_ctx *sim);
+/* print the end-of-run summary */
+extern void sim_report(const struct sim_ctx *sim);
+extern void sim_metrics(const struct sim_ctx *sim, struct sim_metrics *m);
+
+/* uniform in [0,1]; define TRACE_RANDOM to print every draw at TRACE>3 */
+extern double jimsrand(struct sim_ctx *sim);
+extern void printevlist(struct sim_ctx *sim);
+
+#endif
@@ -1,190 +1,626 @@
 #include <stdio.h>
 #include <string.h> 
+#include <stdint.h>
+#include <limits.h>
 #include "emulator.h"
 #include "sr.h"
+#include "trace.h"
+#include "rto.h"
+#include "cc.h"
+#include "sendq.h"
+#include "seqnum.h"
+#include "sack.h"
+#include "checksum.h"
 
 #define RTT 16.0
-#define WINDOWSIZE 6
-#define SEQSPACE 12
+#define WINDOWSIZE 6        /* default */
+#define DUPACKS 3           /* ACKs of later packets that make a loss, with */
+                            /* congestion control                           */
+#define MAXWINDOW 65536     /* largest window that can be configured at run time */
+#define ACKDELAY 10.0       /* default time an ACK waits for data to ride on */
+#define ACKEVERY 2          /* default number of packets one delayed ACK covers */
 #define NOTINUSE -1
-#define BUFFER_INDEX(seqnum) ((seqnum) % SEQSPACE)
+#define SLOT(s, seqnum) ((uint32_t)(seqnum) & (s)->mask)   /* in the rings */
+#define ACKTIMER(s) ((int)(s)->mask + 1)  /* timer id of the delayed ACKs, */
+                                          /* after those of the slots      */
+
+/* ******************************************************************
+   Selective Repeat.  Every packet has its own timer and is ACKed on
+   its own; the receiver buffers packets that arrive out of order.
+
+   With proto_config.bidirectional A and B each run a sender and a
+   receiver, and every data packet carries a cumulative ACK (PKT_CUMACK)
+   of what its receiver delivered in order.  A receiver that delays
+   ACKs (bidirectional, or proto_config.ackevery/ackdelay) holds the
+   ACK of packets received in order back until ACKEVERY of them have
+   arrived, data going the other way can carry it, or the delayed-ACK
+   timer goes off; then one cumulative ACK covers them all.  Packets
+   that arrive out of order and duplicates are ACKed on their own, at
+   once.
+
+   With proto_config.sack ACK-only packets also carry a SACK (sack.h)
+   of the packets the receiver holds, so the sender learns of packets
+   whose own ACK was lost and does not resend them when their timers
+   go off.
+
+   Packets are refcounted buffers (pktbuf.h): the window resends the
+   buffer it handed to layer 3 without copying it, and the receive
+   window keeps the buffers of the packets that arrived.
+
+   With proto_config.cc the sender keeps at most its congestion window
+   (cc.h) of packets in flight.  The window needs to hear of losses
+   before the timers go off, so then the ACKs of DUPACKS later packets
+   while the first one waits mean it was lost, as SACK loss recovery
+   (RFC 6675) takes it: it is resent at once and the window cut.  A
+   packet whose timer goes off is resent whatever the window; only new
+   packets wait for room.
+**********************************************************************/
 
 /* ---------- Packet Utilities ---------- */
-int ComputeChecksum(struct pkt packet) {
-    int checksum = packet.seqnum + packet.acknum;
-    int i;
-    for (i = 0; i < 20; i++) {
-        checksum += (int)(packet.payload[i]);
-    }
-    return checksum;
+static int ComputeChecksum(const struct pkt *packet) {
+    return pkt_checksum(packet, proto_config()->checksum);
 }
 
-int IsCorrupted(struct pkt packet) {
-    return packet.checksum != ComputeChecksum(packet);
+static int IsCorrupted(const struct pkt *packet) {
+    return packet->checksum != ComputeChecksum(packet);
 }
 
-/* ---------- Sender State ---------- */
-static struct pkt window[SEQSPACE]; 
-static int acked[SEQSPACE];
-static int base = 0;
-static int nextseqnum = 0;
-static int timer_active = 0;
+/* ---------- Protocol State ---------- */
 
-void A_output(struct msg message) {
-    struct pkt pkt;
-    int i;
-    if (((nextseqnum - base + SEQSPACE) % SEQSPACE) >= WINDOWSIZE) {
-        if (TRACE > 0)
-            printf("----A: New message arrives, send window is full, drop messge\n");
-        window_full++;
-        return;
-    }
-    if (TRACE > 0)
-        printf("----A: New message arrives, send window is not full, send new messge to layer3!\n");
+/* the sending half of one direction of the transfer */
+struct sr_sender {
+    /* rings of the packets in the window */
+    struct pkt **window;
+    uint64_t *acked;                /* bitmap */
+    double *sendtime;               /* when each packet was first sent */
+    unsigned char *backoff;         /* and how often it was sent again since */
+    struct rto rto;                 /* retransmission timeout, one for all packets */
+    struct cc cc;                   /* congestion window */
+    int dupcount;                   /* packets after base ACKed while it waits */
+    struct sendq queue;             /* messages waiting for room in the window */
+    uint32_t base;
+    uint32_t nextseqnum;
+};
+
+/* the receiving half */
+struct sr_receiver {
+    /* rings of the receive window */
+    uint64_t *received;             /* bitmap: buffered, waiting for a gap to fill */
+    const struct pkt **rcvbuf;
+    uint32_t expected;              /* first seqnum of the receive window */
+    int unacked;                    /* packets received in order whose ACK is */
+                                    /* held back by the delayed-ACK timer      */
+};
 
+/* one per simulation, see sim_protostate() */
+struct sr_state {
+    int windowsize;
+    uint32_t mask;                  /* ring slots - 1, see seqnum.h */
+    int dupthresh;                  /* DUPACKS unless configured, 0 for none */
+    int bidirectional;              /* B sends data too */
+    double ackdelay;                /* how long ACKs are held back, 0 for not */
+    int ackevery;                   /* packets after which they are sent anyway */
+    int sack;                       /* ACK-only packets carry a SACK */
 
-    pkt.seqnum = nextseqnum;
-    pkt.acknum = NOTINUSE;
-    for (i = 0; i < 20; i++) {
-        pkt.payload[i] = message.data[i];
+    /* by entity: A's sender and B's receiver make up the A->B transfer */
+    struct sr_sender snd[2];
+    struct sr_receiver rcv[2];
+};
+
+static struct sr_state *sr(void) {
+    return sim_protostate(sizeof(struct sr_state));
+}
+
+/* pick up the window size of this simulation */
+static void sr_configure(struct sr_state *s) {
+    s->windowsize = proto_config()->windowsize;
+    if (s->windowsize <= 0)
+        s->windowsize = WINDOWSIZE;
+    if (s->windowsize > MAXWINDOW) {
+        printf("Warning: window size %d too large, using %d\n", s->windowsize, MAXWINDOW);
+        s->windowsize = MAXWINDOW;
+    }
+    s->mask = ring_size(s->windowsize) - 1;
+    s->dupthresh = proto_config()->dupacks;
+    if (s->dupthresh == 0)
+        s->dupthresh = DUPACKS;
+    else if (s->dupthresh < 0)
+        s->dupthresh = 0;
+    /* ACKs are delayed by default only when data going the other way */
+    /* can carry them, or when asked to coalesce them                   */
+    s->bidirectional = proto_config()->bidirectional != 0;
+    s->ackdelay = proto_config()->ackdelay;
+    s->ackevery = proto_config()->ackevery;
+    if (s->ackdelay == 0.0 && (s->bidirectional || s->ackevery > 1 || s->ackevery < 0))
+        s->ackdelay = ACKDELAY;
+    if (s->ackdelay <= 0.0 || s->ackevery == 1) {
+        s->ackdelay = 0.0;
+        s->ackevery = 1;
     }
-    pkt.checksum = ComputeChecksum(pkt);
+    else if (s->ackevery == 0)
+        s->ackevery = ACKEVERY;
+    else if (s->ackevery < 0)
+        s->ackevery = INT_MAX;
+    s->sack = proto_config()->sack != 0;
+}
 
-    window[BUFFER_INDEX(pkt.seqnum)] = pkt;
-    acked[BUFFER_INDEX(pkt.seqnum)] = 0;
+/* the statistics follow the timeout of A, the sender of a one-way transfer */
+static void publish_rto(struct sr_state *s, int entity) {
+    if (entity == A)
+        rto_stats(&s->snd[A].rto, sim_stats());
+}
+
+/* and the congestion window */
+static void publish_cc(struct sr_state *s, int entity) {
+    if (entity == A)
+        cc_stats(&s->snd[A].cc, sim_stats());
+    sim_cwnd(entity, s->snd[entity].cc.cwnd);
+}
 
-    if (TRACE > 0) printf("Sending packet %d to layer 3\n", pkt.seqnum);
-    tolayer3(A, pkt);
+/* ---------- Sender ---------- */
 
-    if (!timer_active) {
-        starttimer(A, RTT);
-        timer_active = 1;
+static int window_full(const struct sr_sender *snd) {
+    return seq_dist(snd->base, snd->nextseqnum) >= (uint32_t)cc_window(&snd->cc);
+}
+
+/* send the packet in *bufp, a slot of entity's window, which keeps its */
+/* reference for resending; in a bidirectional run it carries the      */
+/* cumulative ACK of entity's receiver                                  */
+static void transmit(struct sr_state *s, int entity, struct pkt **bufp) {
+    struct sr_receiver *r = &s->rcv[entity];
+    struct pkt *pkt = *bufp;
+    int acknum = NOTINUSE, flags = PKT_DATA;
+
+    if (s->bidirectional) {
+        acknum = (int)(r->expected - 1);
+        flags |= PKT_ACK | PKT_CUMACK;
+        if (r->unacked > 0) {
+            r->unacked = 0;
+            stoptimer_id(entity, ACKTIMER(s));
+            sim_stats()->acks_piggybacked++;
+        }
     }
+    if (pkt->acknum != acknum || pkt->flags != flags) {
+        /* a copy still in flight keeps the ACK it was sent with */
+        pkt = *bufp = pkt_unshare(pkt);
+        pkt->acknum = acknum;
+        pkt->flags = flags;
+        pkt->checksum = ComputeChecksum(pkt);
+    }
+    tolayer3_buf(entity, pkt_hold(pkt));
+}
+
+/* put message in the window and send it; there must be room */
+static void send_message(struct sr_state *s, int entity, const struct msg *message) {
+    struct sr_sender *snd = &s->snd[entity];
+    struct pkt *pkt = pkt_alloc();
+
+    /* transmit() fills in the rest of the header: no packet has flags 0 */
+    pkt->seqnum = snd->nextseqnum;
+    pkt->length = message->length;
+    memcpy(pkt->payload, message->data, message->length);
 
-    nextseqnum = (nextseqnum + 1) % SEQSPACE;
+    bitmap_clear(snd->acked, SLOT(s, pkt->seqnum));
+    snd->sendtime[SLOT(s, pkt->seqnum)] = sim_time();
+    snd->backoff[SLOT(s, pkt->seqnum)] = 0;
+
+    snd->window[SLOT(s, pkt->seqnum)] = pkt;
+    TRACE_LOG(0, TR_A_SEND, entity, pkt->seqnum);
+    transmit(s, entity, &snd->window[SLOT(s, pkt->seqnum)]);
+    /* every packet has its own timer, named by its slot */
+    starttimer_id(entity, SLOT(s, pkt->seqnum), rto_get(&snd->rto));
+
+    snd->nextseqnum++;
+    sim_window(entity, seq_dist(snd->base, snd->nextseqnum));
 }
 
-void A_input(struct pkt packet) {
-    int ack         = packet.acknum;
-    int win_start   = base;
-    int win_end     = (base + WINDOWSIZE) % SEQSPACE;
-    int in_window;
-    
-    /* determine if ack is in [base, base+WINDOWSIZE) */
-    
-    if (IsCorrupted(packet)) {
-        if (TRACE>0) printf("----A: corrupted ACK is received, do nothing!\n");
-        return;
+static void output(struct sr_state *s, int entity, const struct msg *message) {
+    struct sr_sender *snd = &s->snd[entity];
+
+    /* earlier messages waiting in the queue go first */
+    if (!window_full(snd) && snd->queue.count == 0) {
+        TRACE_LOG(0, TR_A_NEWMSG, entity, 0);
+        send_message(s, entity, message);
     }
-    
-    if (TRACE>0) 
-        printf("----A: uncorrupted ACK %d is received\n", ack);
-    total_ACKs_received++;
+    else if (sendq_push(&snd->queue, message))
+        TRACE_LOG(1, TR_A_QUEUE, entity, snd->queue.count);
+    else {
+        TRACE_LOG(0, TR_A_NEWMSG_DROP, entity, 0);
+        sim_stats()->window_full++;
+    }
+}
 
-    if (win_start < win_end)
-        in_window = (ack >= win_start && ack < win_end);
+/* the packet in slot is ACKed: stop its timer and measure the round */
+/* trip, unless it was sent again (Karn's rule)                       */
+static void ack_slot(struct sr_state *s, int entity, uint32_t slot, int sample) {
+    struct sr_sender *snd = &s->snd[entity];
+
+    bitmap_set(snd->acked, slot);
+    stoptimer_id(entity, slot);
+    pkt_release(snd->window[slot]);
+    snd->window[slot] = NULL;
+    if (sample && snd->backoff[slot] == 0)
+        rto_sample(&snd->rto, sim_time() - snd->sendtime[slot]);
     else
-        in_window = (ack >= win_start || ack < win_end);
-
-    if (in_window && !acked[ack]) {
-            acked[ack] = 1;
-            new_ACKs++;
-            if (TRACE>0) 
-                printf("----A: ACK %d is not a duplicate\n", ack);
-            stoptimer(A);
-
-            /* slide base */
-            while (acked[base]) {
-                acked[base] = 0;
-                base = (base + 1) % SEQSPACE;
-            }
-            if (base != nextseqnum) {
-                starttimer(A, RTT);
-            }
-        } 
-        else if (in_window && acked[ack]) {
-        /* 重复 ACK */
-            if (TRACE>0) 
-                printf("----A: ACK %d is a duplicate, do nothing!\n", ack);
+        rto_progress(&snd->rto);
+}
+
+/* resend base, which the ACKs of later packets or a partial ACK */
+/* report lost, without waiting for its timer                    */
+static void fast_resend(struct sr_state *s, int entity) {
+    struct sr_sender *snd = &s->snd[entity];
+    uint32_t slot = SLOT(s, snd->base);
+
+    if (snd->base == snd->nextseqnum)
+        return;
+    TRACE_LOG(0, TR_A_RESEND, entity, snd->window[slot]->seqnum);
+    transmit(s, entity, &snd->window[slot]);
+    sim_stats()->packets_resent++;
+    sim_stats()->packets_fastresent++;
+    if (snd->backoff[slot] < snd->rto.maxbackoff)
+        snd->backoff[slot]++;
+    stoptimer_id(entity, slot);
+    starttimer_id(entity, slot, rto_backoff(&snd->rto, snd->backoff[slot]));
+}
+
+/* the congestion window after an ACK of nacked packets, which moved */
+/* base on from oldbase or not                                       */
+static void ack_cc(struct sr_state *s, int entity, int nacked, uint32_t oldbase) {
+    struct sr_sender *snd = &s->snd[entity];
+
+    if (snd->base != oldbase)
+        snd->dupcount = 0;
+    if (cc_ack(&snd->cc, nacked, snd->base))
+        fast_resend(s, entity);
+    else if (snd->base == oldbase && s->dupthresh > 0 && ++snd->dupcount == s->dupthresh) {
+        TRACE_LOG(0, TR_A_FASTRETX, entity, snd->dupcount);
+        sim_stats()->fast_retransmits++;
+        cc_loss(&snd->cc, seq_dist(snd->base, snd->nextseqnum), snd->base, snd->nextseqnum);
+        fast_resend(s, entity);
     }
-    /* out-of-window 的 ACK 什么也不做 */
+    publish_cc(s, entity);
 }
 
-void A_timerinterrupt(void) {
-    int i;
-    if (base == nextseqnum) {
-        timer_active = 0;
+/* whether packet acknowledges seq by its acknum, rather than by a SACK */
+static int acks(const struct pkt *packet, uint32_t seq) {
+    uint32_t ack = (uint32_t)packet->acknum;
+
+    return seq == ack || ((packet->flags & PKT_CUMACK) && seq_lt(seq, ack));
+}
+
+/* whether packet acknowledges seq at all */
+static int covers(const struct sr_state *s, const struct pkt *packet, uint32_t seq) {
+    return acks(packet, seq) ||
+           (s->sack && (packet->flags & PKT_SACK) && sack_test(packet->payload, seq));
+}
+
+/* an uncorrupted ACK arrived for entity's sender, on its own or on data */
+static void receive_ack(struct sr_state *s, int entity, const struct pkt *packet) {
+    struct sr_sender *snd = &s->snd[entity];
+    struct msg message;
+    uint32_t ack    = (uint32_t)packet->acknum;
+    uint32_t first, end, seq, oldbase = snd->base;
+    int in_window, fresh = 0, nacked = 0;
+
+    TRACE_LOG(0, TR_A_ACK, entity, ack);
+    sim_stats()->total_ACKs_received++;
+
+    /* determine if ack is in [base, nextseqnum), as serial numbers */
+    in_window = seq_le(snd->base, ack) && seq_lt(ack, snd->nextseqnum);
+
+    /* the packets the ACK can cover: ack, every packet before it if it */
+    /* is cumulative, and those up to the last one a SACK can report    */
+    first = end = snd->base;
+    if (in_window) {
+        end = ack + 1;
+        if (!(packet->flags & PKT_CUMACK))
+            first = ack;
+    }
+    if (s->sack && (packet->flags & PKT_SACK)) {
+        first = snd->base;
+        seq = sack_base(packet->payload) + 1 + SACK_BITS;
+        if (seq_lt(end, seq))
+            end = seq_lt(snd->nextseqnum, seq) ? snd->nextseqnum : seq;
+    }
+    for (seq = first; seq_lt(seq, end); seq++)
+        if (!bitmap_test(snd->acked, SLOT(s, seq)) && covers(s, packet, seq))
+            fresh = 1;
+    if (!fresh) {
+        /* 重复 ACK；out-of-window 的 ACK 什么也不做 */
+        if (in_window)
+            TRACE_LOG(0, TR_A_DUPACK_N, entity, ack);
         return;
     }
-    if (TRACE > 0) printf("----A: time out,resend packets!\n");
-    for (i = 0; i < WINDOWSIZE; i++) {
-        int seq = (base + i) % SEQSPACE;
-        if (!acked[BUFFER_INDEX(seq)]) {
-            if (TRACE > 0)
-                printf("---A: resending packet %d\n", seq);
-            tolayer3(A, window[BUFFER_INDEX(seq)]);
-            packets_resent++;
-            starttimer(A, RTT);
-            timer_active = 1;
-            return;
+    sim_stats()->new_ACKs++;
+    TRACE_LOG(0, TR_A_NEWACK, entity, ack);
+    /* the round trip is measured on the packet ACKed by number, the */
+    /* others waited for it                                          */
+    for (seq = first; seq_lt(seq, end); seq++)
+        if (!bitmap_test(snd->acked, SLOT(s, seq)) && covers(s, packet, seq)) {
+            if (!acks(packet, seq))
+                sim_stats()->packets_sacked++;
+            ack_slot(s, entity, SLOT(s, seq), seq == ack);
+            nacked++;
         }
+    publish_rto(s, entity);
+
+    /* slide base */
+    while (snd->base != snd->nextseqnum && bitmap_test(snd->acked, SLOT(s, snd->base))) {
+        bitmap_clear(snd->acked, SLOT(s, snd->base));
+        snd->base++;
+    }
+    sim_window(entity, seq_dist(snd->base, snd->nextseqnum));
+    if (snd->cc.mode != CC_NONE)
+        ack_cc(s, entity, nacked, oldbase);
+
+    /* fill the window from the send queue */
+    while (!window_full(snd) && sendq_pop(&snd->queue, &message))
+        send_message(s, entity, &message);
+}
+
+/* the timer of the packet in slot went off: it is still unacked, resend */
+/* it and back its own timer off, leaving the other packets' timers alone */
+static void timeout(struct sr_state *s, int entity, int slot) {
+    struct sr_sender *snd = &s->snd[entity];
+
+    TRACE_LOG(0, TR_A_TIMEOUT, entity, 0);
+    TRACE_LOG(0, TR_A_RESEND, entity, snd->window[slot]->seqnum);
+    transmit(s, entity, &snd->window[slot]);
+    sim_stats()->packets_resent++;
+    if (snd->backoff[slot] < snd->rto.maxbackoff)
+        snd->backoff[slot]++;
+    rto_timeout(&snd->rto);
+    publish_rto(s, entity);
+    cc_timeout(&snd->cc, seq_dist(snd->base, snd->nextseqnum), snd->window[slot]->seqnum,
+               snd->nextseqnum);
+    publish_cc(s, entity);
+    starttimer_id(entity, slot, rto_backoff(&snd->rto, snd->backoff[slot]));
+}
+
+static void sender_init(struct sr_state *s, int entity) {
+    struct sr_sender *snd = &s->snd[entity];
+
+    snd->window = sim_alloc((s->mask + 1) * sizeof(struct pkt *));
+    snd->acked = sim_alloc(BITMAP_WORDS(s->mask + 1) * sizeof(uint64_t));
+    snd->sendtime = sim_alloc((s->mask + 1) * sizeof(double));
+    snd->backoff = sim_alloc(s->mask + 1);
+    snd->base = 0;
+    snd->nextseqnum = 0;
+    rto_init(&snd->rto, RTT, s->ackdelay, proto_config()->fixedrto, s->windowsize);
+    publish_rto(s, entity);
+    cc_init(&snd->cc, proto_config()->cc, s->windowsize);
+    snd->dupcount = 0;
+    publish_cc(s, entity);
+    sendq_init(&snd->queue, entity, proto_config()->sendqueue, sim_backpressure);
+}
+
+/* ---------- Receiver ---------- */
+
+/* how far seq is past the start of the receive window, negative */
+/* for the sequence numbers before it                             */
+static int32_t rcv_offset(const struct sr_receiver *r, uint32_t seq) {
+    return (int32_t)(seq - r->expected);
+}
+
+/* send an ACK-only packet, with the SACK of the receiver if configured */
+static void send_ackpkt(struct sr_state *s, int entity, uint32_t acknum, int flags) {
+    struct sr_receiver *r = &s->rcv[entity];
+    struct pkt *ackpkt = pkt_alloc();
+
+    ackpkt->seqnum = NOTINUSE;
+    ackpkt->acknum  = (int)acknum;
+    ackpkt->flags = flags;
+    if (s->sack) {
+        sack_encode(ackpkt->payload, r->expected, r->received, s->mask, s->windowsize);
+        ackpkt->length = SACK_SIZE;
+        ackpkt->flags |= PKT_SACK;
+    } else {
+        ackpkt->length = 0;
     }
-    timer_active = 0;
+    ackpkt->checksum = ComputeChecksum(ackpkt);
+    tolayer3_buf(entity, ackpkt);
+    sim_stats()->acks_alone++;
 }
 
+/* ACK seq in a packet of its own */
+static void send_ack(struct sr_state *s, int entity, uint32_t seq) {
+    send_ackpkt(s, entity, seq, PKT_ACK);
+}
+
+/* ACK everything delivered in order in a packet of its own */
+static void send_cumack(struct sr_state *s, int entity) {
+    struct sr_receiver *r = &s->rcv[entity];
 
-void A_init(void) {
-    int i;
-    for (i = 0; i < SEQSPACE; i++) {
-        acked[i] = 0;
+    send_ackpkt(s, entity, r->expected - 1, PKT_ACK | PKT_CUMACK);
+    if (r->unacked > 0) {
+        r->unacked = 0;
+        stoptimer_id(entity, ACKTIMER(s));
     }
-    base = 0;
-    nextseqnum = 0;
-    timer_active = 0;
-}
-
-/* ---------- Receiver State ---------- */
-static int received[SEQSPACE];
-static int expected = 0;
-
-void B_input(struct pkt packet) {
-    int seq;
-    struct pkt ackpkt;
-    seq = packet.seqnum;
-
-    if (!IsCorrupted(packet) && seq == expected) {
-        if (TRACE > 0)
-            printf("----B: packet %d is correctly received, send ACK!\n", seq);
-        packets_received++;
-        tolayer5(B, packet.payload);
-        expected = (expected + 1) % SEQSPACE;
+}
+
+/* the new packet seq arrived in order: hold its ACK back, unless */
+/* ackevery packets are waiting for one now                        */
+static void ack_inorder(struct sr_state *s, int entity, uint32_t seq) {
+    struct sr_receiver *r = &s->rcv[entity];
+
+    if (s->ackdelay == 0.0)
+        send_ack(s, entity, seq);
+    else if (++r->unacked >= s->ackevery)
+        send_cumack(s, entity);
+    else if (r->unacked == 1)
+        starttimer_id(entity, ACKTIMER(s), s->ackdelay);
+}
+
+/* an uncorrupted data packet arrived for entity's receiver */
+static void receive_data(struct sr_state *s, int entity, const struct pkt *packet) {
+    struct sr_receiver *r = &s->rcv[entity];
+    uint32_t seq;
+    int32_t offset;
+    int fresh = 0, inorder;
+    seq = (uint32_t)packet->seqnum;
+
+    offset = rcv_offset(r, seq);
+    if (offset >= 0 && offset < s->windowsize) {
+        /* in the receive window: buffer it, then deliver what is contiguous */
+        inorder = seq == r->expected;
+        if (!bitmap_test(r->received, SLOT(s, seq))) {
+            if (seq == r->expected)
+                TRACE_LOG(0, TR_B_RECV, entity, seq);
+            else
+                TRACE_LOG(0, TR_B_BUFFER, entity, seq);
+            sim_stats()->packets_received++;
+            bitmap_set(r->received, SLOT(s, seq));
+            r->rcvbuf[SLOT(s, seq)] = pkt_hold(packet);
+            fresh = 1;
+        } else {
+            TRACE_LOG(0, TR_B_DUP, entity, seq);
+        }
+        while (bitmap_test(r->received, SLOT(s, r->expected))) {
+            tolayer5_len(entity, r->rcvbuf[SLOT(s, r->expected)]->payload,
+                         r->rcvbuf[SLOT(s, r->expected)]->length);
+            pkt_release(r->rcvbuf[SLOT(s, r->expected)]);
+            bitmap_clear(r->received, SLOT(s, r->expected));
+            r->expected++;
+        }
+        if (fresh && inorder)
+            ack_inorder(s, entity, seq);
+        else
+            send_ack(s, entity, seq);
+    } else if (offset < 0 && offset >= -s->windowsize) {
+        /* delivered already, its ACK must have been lost: ACK it again */
+        TRACE_LOG(0, TR_B_DUP, entity, seq);
+        send_ack(s, entity, seq);
     } else {
-        if (TRACE > 0)
-            printf("----B: packet corrupted or not expected sequence number, resend ACK!\n");
+        TRACE_LOG(0, TR_B_DROP, entity, 0);
     }
+}
+
+/* the delayed-ACK timer went off without data to carry the ACK */
+static void acktimeout(struct sr_state *s, int entity) {
+    struct sr_receiver *r = &s->rcv[entity];
+
+    TRACE_LOG(0, TR_B_DELACK, entity, (int)(r->expected - 1));
+    r->unacked = 0;
+    sim_stats()->acks_delayed++;
+    send_cumack(s, entity);
+}
 
-    /* build ACK */
-    ackpkt.seqnum = NOTINUSE;
-    ackpkt.acknum  = packet.seqnum; 
-    memset(ackpkt.payload, '0', sizeof ackpkt.payload);
-    ackpkt.checksum = ComputeChecksum(ackpkt);
-    tolayer3(B, ackpkt);
+static void receiver_init(struct sr_state *s, int entity) {
+    struct sr_receiver *r = &s->rcv[entity];
 
+    r->received = sim_alloc(BITMAP_WORDS(s->mask + 1) * sizeof(uint64_t));
+    r->rcvbuf = sim_alloc((s->mask + 1) * sizeof(struct pkt *));
+    r->expected = 0;
+    r->unacked = 0;
 }
 
-void B_init(void) {
-    int i;
-    for (i = 0; i < SEQSPACE; i++) {
-        received[i] = 0;
+/* a packet arrived at entity, in a buffer lent for the call: data   */
+/* first, so that messages the ACK lets out can take the ACK of the */
+/* data along                                                        */
+static void input(struct sr_state *s, int entity, const struct pkt *packet) {
+    if (IsCorrupted(packet)) {
+        /* the channel leaves the flags alone */
+        if (packet->flags & PKT_DATA)
+            TRACE_LOG(0, TR_B_DROP, entity, 0);
+        else
+            TRACE_LOG(0, TR_A_CORRUPTACK, entity, 0);
+        return;
     }
-    expected = 0;
+    if (packet->flags & PKT_DATA)
+        receive_data(s, entity, packet);
+    if (packet->flags & PKT_ACK)
+        receive_ack(s, entity, packet);
+}
+
+/* the by-value entry point: the packet goes into a buffer of its own */
+static void input_copy(int entity, struct pkt packet) {
+    struct pkt *buf = pkt_alloc();
+
+    pkt_copy(buf, &packet);
+    input(sr(), entity, buf);
+    pkt_release(buf);
+}
+
+/* ---------- Entities ---------- */
+
+/* logical timers: the packet timers by slot, then the delayed ACK */
+static void entity_timeout(int entity, int id) {
+    struct sr_state *s = sr();
+
+    if (id == ACKTIMER(s))
+        acktimeout(s, entity);
+    else
+        timeout(s, entity, id);
+}
+
+static void A_output(struct msg message) {
+    output(sr(), A, &message);
+}
+
+static void A_input(struct pkt packet) {
+    input_copy(A, packet);
+}
+
+static void A_input_buf(const struct pkt *packet) {
+    input(sr(), A, packet);
+}
+
+static void A_timerinterrupt(void) {
+    /* not used, see A_timeout */
+}
+
+static void A_timeout(int id) {
+    entity_timeout(A, id);
+}
+
+static void A_init(void) {
+    struct sr_state *s = sr();
+    sr_configure(s);
+    sender_init(s, A);
+    if (s->bidirectional)
+        receiver_init(s, A);
+}
+
+static void B_output(struct msg message) {
+    output(sr(), B, &message);
+}
+
+static void B_input(struct pkt packet) {
+    input_copy(B, packet);
+}
+
+static void B_input_buf(const struct pkt *packet) {
+    input(sr(), B, packet);
+}
+
+static void B_timerinterrupt(void) { 
+    /* not used, see B_timeout */ 
 }
 
-void B_output(struct msg message) { 
-    /* not used */ 
+static void B_timeout(int id) {
+    entity_timeout(B, id);
 }
 
-void B_timerinterrupt(void) { 
-    /* not used */ 
+static void B_init(void) {
+    struct sr_state *s = sr();
+    sr_configure(s);
+    if (s->bidirectional)
+        sender_init(s, B);
+    receiver_init(s, B);
 }
 
+const struct transport_ops sr_ops = {
+    "sr",
+    A_init,
+    B_init,
+    A_output,
+    A_input,
+    A_timerinterrupt,
+    B_output,
+    B_input,
+    B_timerinterrupt,
+    A_timeout,
+    B_timeout,
+    A_input_buf,
+    B_input_buf
+};
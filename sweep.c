@@ -0,0 +1,673 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "sim.h"
+#include "checksum.h"
+#include "cc.h"
+
+/* ******************************************************************
+   Batch driver: runs a grid of simulations on a pool of worker
+   threads and prints the final counters and metrics (sim_metrics)
+   of every run as one CSV or JSON table.
+
+   usage: sweep [-j threads] [-f csv|json] [specfile]
+
+   The sweep spec (specfile, or stdin) has one parameter per line,
+   followed by its value or values; '#' starts a comment:
+
+     messages   10000          # msgs to generate per run
+     loss       0.0 0.1 0.2    # grid axes: every combination is run
+     corrupt    0.0 0.1
+     lambda     5 10 20
+     window     6 8            # 0 = the protocol's default window
+     dupacks    0 -1           # fast retransmit threshold, -1 = none
+     queue      0 64           # send queue capacity, 0 = none
+     backpressure on           # layer 5 waits for a full queue
+     bidirectional on          # B sends messages too
+     ackdelay   -1 5 10        # delayed ACK, -1 = none, 0 = default
+     ackevery   0 2 4          # packets per delayed ACK, -1 = no limit
+     sack       0 1            # selective ACKs
+     msgsize    20 1500 9000   # mean message size in bytes
+     msgdist    fixed          # or uniform, exp, imix
+     bandwidth  0 160 800      # link bits per time unit, 0 = random delay
+     linkqueue  0 8 32         # packets a link queue holds, 0 = no limit
+     linkbytes  0              # bytes it holds, 0 = no limit
+     propdelay  5              # link propagation delay
+     aqm        droptail       # or red
+     red        5 15 0.1 0.002 # RED min, max, max drop probability, weight
+     lossmodel  ge             # or bernoulli, the loss probability
+     ge         0.01 0.3 0 1   # Gilbert-Elliott p, r, loss when good, bad
+     reorder    0.05 3         # probability a packet may overtake, depth
+     dup        0.01           # probability a packet arrives twice
+     cc         none newreno   # congestion control: none, aimd, newreno
+     protocol   gbn sr
+     direction  2              # 0 A->B, 1 A<-B, 2 both
+     reps       4              # replications of every grid point
+     seed       9999
+     rng        xoshiro        # or compat, the rand() sequence
+     checksum   sum            # or inet, crc32c
+     sched      heap4
+     rto        adaptive       # or fixed, the assignment's constant RTT
+     threads    8              # default: one per online CPU
+     format     csv
+
+   Every grid point of replication r draws from random stream r of
+   the seed, so points differ only in their parameters (common random
+   numbers) while replications are independent.  The link parameters
+   apply to both directions, the loss model, reordering and
+   duplication to those direction picks.  Runs share nothing
+   but the work counter, and the table lists them in grid order
+   whatever the number of threads.
+**********************************************************************/
+
+#define MAXVALUES 64          /* values per grid axis */
+
+struct axis {
+  int n;
+  double v[MAXVALUES];
+};
+
+struct spec {
+  struct sim_config base;     /* parameters common to every run */
+  struct axis loss, corrupt, lambda, window, dupacks, queue, ackdelay, ackevery, sack;
+  struct axis msgsize, bandwidth, linkqueue, cc;
+  const struct transport_ops *protocol[MAXVALUES];
+  int nprotocols;
+  int reps;
+  int threads;
+  int json;
+};
+
+/* one run of the sweep and its outcome */
+struct run {
+  struct sim_config cfg;
+  int rep;
+  int ok;
+  struct sim_stats stats;
+  struct sim_metrics metrics;
+  float time;                 /* simulated time at the end of the run */
+  int nsim;                   /* messages generated */
+};
+
+struct workqueue {
+  struct run *runs;
+  int nruns;
+  int next;                   /* next run to hand out */
+  pthread_mutex_t lock;
+};
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: sweep [-j threads] [-f csv|json] [specfile]\n");
+  exit(EXIT_FAILURE);
+}
+
+static void specerror(int line, const char *what, const char *word)
+{
+  fprintf(stderr, "sweep: line %d: %s \"%s\"\n", line, what, word);
+  exit(EXIT_FAILURE);
+}
+
+/* parse the values following an axis keyword */
+static void parseaxis(struct axis *ax, int line, char *word)
+{
+  char *end;
+
+  ax->n = 0;
+  for (word = strtok(NULL, " \t\r\n"); word != NULL; word = strtok(NULL, " \t\r\n")) {
+    if (ax->n == MAXVALUES)
+      specerror(line, "too many values at", word);
+    ax->v[ax->n++] = strtod(word, &end);
+    if (*end != '\0')
+      specerror(line, "bad number", word);
+  }
+  if (ax->n == 0)
+    specerror(line, "no values for", "");
+}
+
+/* the single integer following a keyword */
+static int parseint(int line, const char *key)
+{
+  char *word = strtok(NULL, " \t\r\n"), *end;
+  long v;
+
+  if (word == NULL)
+    specerror(line, "missing value for", key);
+  v = strtol(word, &end, 10);
+  if (*end != '\0')
+    specerror(line, "bad number", word);
+  return (int)v;
+}
+
+/* the single number following a keyword */
+static double parsedouble(int line, const char *key)
+{
+  char *word = strtok(NULL, " \t\r\n"), *end;
+  double v;
+
+  if (word == NULL)
+    specerror(line, "missing value for", key);
+  v = strtod(word, &end);
+  if (*end != '\0')
+    specerror(line, "bad number", word);
+  return v;
+}
+
+static void readspec(FILE *fp, struct spec *sp)
+{
+  char buf[1024], *word, *hash;
+  struct axis vals;
+  int line = 0, i;
+
+  while (fgets(buf, sizeof(buf), fp) != NULL) {
+    line++;
+    if ((hash = strchr(buf, '#')) != NULL)
+      *hash = '\0';
+    word = strtok(buf, " \t\r\n");
+    if (word == NULL)
+      continue;
+    if (strcmp(word, "messages") == 0)
+      sp->base.nsimmax = parseint(line, word);
+    else if (strcmp(word, "loss") == 0)
+      parseaxis(&sp->loss, line, word);
+    else if (strcmp(word, "corrupt") == 0)
+      parseaxis(&sp->corrupt, line, word);
+    else if (strcmp(word, "lambda") == 0)
+      parseaxis(&sp->lambda, line, word);
+    else if (strcmp(word, "window") == 0)
+      parseaxis(&sp->window, line, word);
+    else if (strcmp(word, "dupacks") == 0)
+      parseaxis(&sp->dupacks, line, word);
+    else if (strcmp(word, "queue") == 0)
+      parseaxis(&sp->queue, line, word);
+    else if (strcmp(word, "ackdelay") == 0)
+      parseaxis(&sp->ackdelay, line, word);
+    else if (strcmp(word, "ackevery") == 0)
+      parseaxis(&sp->ackevery, line, word);
+    else if (strcmp(word, "sack") == 0)
+      parseaxis(&sp->sack, line, word);
+    else if (strcmp(word, "msgsize") == 0)
+      parseaxis(&sp->msgsize, line, word);
+    else if (strcmp(word, "bandwidth") == 0)
+      parseaxis(&sp->bandwidth, line, word);
+    else if (strcmp(word, "linkqueue") == 0)
+      parseaxis(&sp->linkqueue, line, word);
+    else if (strcmp(word, "linkbytes") == 0)
+      sp->base.link[A].qbytes = sp->base.link[B].qbytes = parseint(line, word);
+    else if (strcmp(word, "propdelay") == 0)
+      sp->base.link[A].propdelay = sp->base.link[B].propdelay = parsedouble(line, word);
+    else if (strcmp(word, "aqm") == 0) {
+      word = strtok(NULL, " \t\r\n");
+      if (word == NULL || (sp->base.link[A].aqm = link_aqm_byname(word)) < 0)
+        specerror(line, "unknown queue discipline", word ? word : "");
+      sp->base.link[B].aqm = sp->base.link[A].aqm;
+    }
+    else if (strcmp(word, "lossmodel") == 0) {
+      word = strtok(NULL, " \t\r\n");
+      if (word == NULL || (sp->base.link[A].loss = link_loss_byname(word)) < 0)
+        specerror(line, "unknown loss model", word ? word : "");
+      sp->base.link[B].loss = sp->base.link[A].loss;
+    }
+    else if (strcmp(word, "ge") == 0) {
+      parseaxis(&vals, line, word);
+      if (vals.n > 4)
+        specerror(line, "more than 4 values for", "ge");
+      for (i = 0; i < 2; i++) {
+        sp->base.link[i].ge_p = vals.v[0];
+        sp->base.link[i].ge_r = vals.n > 1 ? vals.v[1] : 0.0;
+        sp->base.link[i].ge_good = vals.n > 2 ? vals.v[2] : 0.0;
+        sp->base.link[i].ge_bad = vals.n > 3 ? vals.v[3] : 0.0;
+      }
+    }
+    else if (strcmp(word, "reorder") == 0) {
+      parseaxis(&vals, line, word);
+      if (vals.n > 2)
+        specerror(line, "more than 2 values for", "reorder");
+      for (i = 0; i < 2; i++) {
+        sp->base.link[i].reorder = vals.v[0];
+        sp->base.link[i].reorder_depth = vals.n > 1 ? (int)vals.v[1] : 0;
+      }
+    }
+    else if (strcmp(word, "dup") == 0)
+      sp->base.link[A].dup = sp->base.link[B].dup = parsedouble(line, word);
+    else if (strcmp(word, "red") == 0) {
+      parseaxis(&vals, line, word);
+      if (vals.n > 4)
+        specerror(line, "more than 4 values for", "red");
+      for (i = 0; i < 2; i++) {
+        sp->base.link[i].red_min = vals.v[0];
+        sp->base.link[i].red_max = vals.n > 1 ? vals.v[1] : 0.0;
+        sp->base.link[i].red_maxp = vals.n > 2 ? vals.v[2] : 0.0;
+        sp->base.link[i].red_weight = vals.n > 3 ? vals.v[3] : 0.0;
+      }
+    }
+    else if (strcmp(word, "cc") == 0) {
+      sp->cc.n = 0;
+      for (word = strtok(NULL, " \t\r\n"); word != NULL; word = strtok(NULL, " \t\r\n")) {
+        if (sp->cc.n == MAXVALUES)
+          specerror(line, "too many values at", word);
+        if ((sp->cc.v[sp->cc.n++] = cc_byname(word)) < 0)
+          specerror(line, "unknown congestion control", word);
+      }
+      if (sp->cc.n == 0)
+        specerror(line, "no values for", "cc");
+    }
+    else if (strcmp(word, "protocol") == 0) {
+      sp->nprotocols = 0;
+      for (word = strtok(NULL, " \t\r\n"); word != NULL; word = strtok(NULL, " \t\r\n")) {
+        if (sp->nprotocols == MAXVALUES)
+          specerror(line, "too many values at", word);
+        if ((sp->protocol[sp->nprotocols++] = transport_byname(word)) == NULL)
+          specerror(line, "unknown protocol", word);
+      }
+      if (sp->nprotocols == 0)
+        specerror(line, "no values for", "protocol");
+    }
+    else if (strcmp(word, "direction") == 0)
+      sp->base.corruptdirection = parseint(line, word);
+    else if (strcmp(word, "reps") == 0)
+      sp->reps = parseint(line, word);
+    else if (strcmp(word, "seed") == 0)
+      sp->base.seed = (unsigned int)parseint(line, word);
+    else if (strcmp(word, "threads") == 0)
+      sp->threads = parseint(line, word);
+    else if (strcmp(word, "rng") == 0) {
+      word = strtok(NULL, " \t\r\n");
+      if (word == NULL || (sp->base.rng = rng_byname(word)) < 0)
+        specerror(line, "unknown generator", word ? word : "");
+    }
+    else if (strcmp(word, "checksum") == 0) {
+      word = strtok(NULL, " \t\r\n");
+      if (word == NULL || (sp->base.proto.checksum = cksum_byname(word)) < 0)
+        specerror(line, "unknown checksum", word ? word : "");
+    }
+    else if (strcmp(word, "msgdist") == 0) {
+      word = strtok(NULL, " \t\r\n");
+      if (word == NULL || (sp->base.msgdist = msgdist_byname(word)) < 0)
+        specerror(line, "unknown message size distribution", word ? word : "");
+    }
+    else if (strcmp(word, "sched") == 0) {
+      word = strtok(NULL, " \t\r\n");
+      if (word == NULL || (sp->base.sched = sched_byname(word)) < 0)
+        specerror(line, "unknown scheduler", word ? word : "");
+    }
+    else if (strcmp(word, "rto") == 0) {
+      word = strtok(NULL, " \t\r\n");
+      if (word != NULL && strcmp(word, "fixed") == 0)
+        sp->base.proto.fixedrto = 1;
+      else if (word != NULL && strcmp(word, "adaptive") == 0)
+        sp->base.proto.fixedrto = 0;
+      else
+        specerror(line, "unknown timeout", word ? word : "");
+    }
+    else if (strcmp(word, "backpressure") == 0) {
+      word = strtok(NULL, " \t\r\n");
+      if (word != NULL && strcmp(word, "on") == 0)
+        sp->base.backpressure = 1;
+      else if (word != NULL && strcmp(word, "off") == 0)
+        sp->base.backpressure = 0;
+      else
+        specerror(line, "expected on or off for backpressure, got", word ? word : "");
+    }
+    else if (strcmp(word, "bidirectional") == 0) {
+      word = strtok(NULL, " \t\r\n");
+      if (word != NULL && strcmp(word, "on") == 0)
+        sp->base.proto.bidirectional = 1;
+      else if (word != NULL && strcmp(word, "off") == 0)
+        sp->base.proto.bidirectional = 0;
+      else
+        specerror(line, "expected on or off for bidirectional, got", word ? word : "");
+    }
+    else if (strcmp(word, "format") == 0) {
+      word = strtok(NULL, " \t\r\n");
+      if (word != NULL && strcmp(word, "json") == 0)
+        sp->json = 1;
+      else if (word != NULL && strcmp(word, "csv") == 0)
+        sp->json = 0;
+      else
+        specerror(line, "unknown format", word ? word : "");
+    }
+    else
+      specerror(line, "unknown parameter", word);
+  }
+}
+
+/* an axis the spec left out takes a single value */
+static void defaultaxis(struct axis *ax, double v)
+{
+  if (ax->n == 0) {
+    ax->n = 1;
+    ax->v[0] = v;
+  }
+}
+
+/* expand the grid into the list of runs, in output order */
+static struct run *makeruns(const struct spec *sp, int *nruns)
+{
+  struct run *runs, *r;
+  int il, ic, ia, iw, id, iq, ik, ie, is, im, ib, iz, ix, ip, rep, n;
+
+  n = sp->loss.n * sp->corrupt.n * sp->lambda.n * sp->window.n * sp->dupacks.n *
+      sp->queue.n * sp->ackdelay.n * sp->ackevery.n *
+      sp->sack.n * sp->msgsize.n * sp->bandwidth.n * sp->linkqueue.n * sp->cc.n *
+      sp->nprotocols * sp->reps;
+  runs = calloc(n, sizeof(struct run));
+  if (runs == NULL) {
+    fprintf(stderr, "sweep: memory allocation for %d runs failed\n", n);
+    exit(EXIT_FAILURE);
+  }
+  r = runs;
+  for (il = 0; il < sp->loss.n; il++)
+    for (ic = 0; ic < sp->corrupt.n; ic++)
+      for (ia = 0; ia < sp->lambda.n; ia++)
+        for (iw = 0; iw < sp->window.n; iw++)
+          for (id = 0; id < sp->dupacks.n; id++)
+            for (iq = 0; iq < sp->queue.n; iq++)
+              for (ik = 0; ik < sp->ackdelay.n; ik++)
+                for (ie = 0; ie < sp->ackevery.n; ie++)
+                  for (is = 0; is < sp->sack.n; is++)
+                    for (im = 0; im < sp->msgsize.n; im++)
+                      for (ib = 0; ib < sp->bandwidth.n; ib++)
+                        for (iz = 0; iz < sp->linkqueue.n; iz++)
+                          for (ix = 0; ix < sp->cc.n; ix++)
+                            for (ip = 0; ip < sp->nprotocols; ip++)
+                              for (rep = 0; rep < sp->reps; rep++, r++) {
+                                r->cfg = sp->base;
+                                r->cfg.lossprob = sp->loss.v[il];
+                                r->cfg.corruptprob = sp->corrupt.v[ic];
+                                r->cfg.lambda = sp->lambda.v[ia];
+                                r->cfg.proto.windowsize = (int)sp->window.v[iw];
+                                r->cfg.proto.dupacks = (int)sp->dupacks.v[id];
+                                r->cfg.proto.sendqueue = (int)sp->queue.v[iq];
+                                r->cfg.proto.ackdelay = sp->ackdelay.v[ik];
+                                r->cfg.proto.ackevery = (int)sp->ackevery.v[ie];
+                                r->cfg.proto.sack = (int)sp->sack.v[is];
+                                r->cfg.msgsize = (int)sp->msgsize.v[im];
+                                r->cfg.link[A].bandwidth = sp->bandwidth.v[ib];
+                                r->cfg.link[B].bandwidth = sp->bandwidth.v[ib];
+                                r->cfg.link[A].qlimit = (int)sp->linkqueue.v[iz];
+                                r->cfg.link[B].qlimit = (int)sp->linkqueue.v[iz];
+                                r->cfg.proto.cc = (int)sp->cc.v[ix];
+                                r->cfg.transport = sp->protocol[ip];
+                                r->cfg.stream = rep;
+                                r->rep = rep;
+                              }
+  *nruns = n;
+  return runs;
+}
+
+static void dorun(struct run *r)
+{
+  struct sim_ctx *sim = sim_create(&r->cfg);
+
+  if (sim == NULL)
+    return;
+  sim_run(sim);
+  r->stats = sim->stats;
+  sim_metrics(sim, &r->metrics);
+  r->time = sim->time;
+  r->nsim = sim->nsim;
+  r->ok = 1;
+  sim_destroy(sim);
+}
+
+static void *worker(void *arg)
+{
+  struct workqueue *q = arg;
+  int i;
+
+  for (;;) {
+    pthread_mutex_lock(&q->lock);
+    i = q->next++;
+    pthread_mutex_unlock(&q->lock);
+    if (i >= q->nruns)
+      return NULL;
+    dorun(&q->runs[i]);
+  }
+}
+
+/* the link whose loss model, reordering and duplication the tables */
+/* show: B's when only A<-B is impaired                              */
+static int impaired(const struct run *r)
+{
+  return r->cfg.corruptdirection == B ? B : A;
+}
+
+static void printcsv(const struct run *runs, int n)
+{
+  const struct run *r;
+  int i;
+
+  printf("protocol,loss,corrupt,direction,lambda,window,dupacks,queue,backpressure,"
+         "bidirectional,ackdelay,ackevery,sack,checksum,msgsize,msgdist,"
+         "bandwidth,propdelay,linkqueue,linkbytes,aqm,lossmodel,reorder,dup,cc,"
+         "rng,seed,rep,messages,sent,"
+         "window_full,new_ACKs,total_ACKs_received,packets_resent,"
+         "fast_retransmits,packets_fastresent,"
+         "packets_received,messages_delivered,ntolayer3,nlost,ncorrupt,time,"
+         "latency_mean,latency_p50,latency_p99,latency_p999,latency_max,"
+         "goodput,retransmit_ratio,window_mean,window_max,"
+         "rtt_samples,timeouts,srtt,rttvar,rto,"
+         "queue_mean,queue_max,queuedelay_mean,queuedelay_p99,queuedelay_max,"
+         "backpressured,blocked_time,acks_alone,acks_delayed,acks_piggybacked,"
+         "ack_ratio,packets_sacked,bytes_delivered,bytes_tolayer3,header_tolayer3,"
+         "byte_goodput,header_overhead,qdrops,reddrops,"
+         "link_util_ab,linkq_mean_ab,linkq_max_ab,link_util_ba,linkq_mean_ba,linkq_max_ba,"
+         "reordered,duplicated,loss_burst_mean,cwnd_mean,cwnd,ssthresh,cwnd_reductions\n");
+  for (i = 0; i < n; i++) {
+    r = &runs[i];
+    printf("%s,%g,%g,%d,%g,%d,%d,%d,%d,%d,%g,%d,%d,%s,%d,%s,%g,%g,%d,%d,%s,%s,%g,%g,%s,%s,%u,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%f,"
+           "%f,%f,%f,%f,%f,%f,%f,%f,%d,%d,%d,%f,%f,%f,%f,%d,%f,%f,%f,%d,%f,%d,%d,%d,%f,%d,"
+           "%lld,%lld,%lld,%f,%f,%d,%d,%f,%f,%d,%f,%f,%d,%d,%d,%f,%f,%f,%f,%d\n",
+           r->cfg.transport->name, r->cfg.lossprob, r->cfg.corruptprob,
+           r->cfg.corruptdirection, r->cfg.lambda, r->cfg.proto.windowsize, r->cfg.proto.dupacks,
+           r->cfg.proto.sendqueue, r->cfg.backpressure,
+           r->cfg.proto.bidirectional, r->cfg.proto.ackdelay, r->cfg.proto.ackevery,
+           r->cfg.proto.sack, cksum_name(r->cfg.proto.checksum),
+           r->cfg.msgsize, msgdist_name(r->cfg.msgdist),
+           r->cfg.link[A].bandwidth, r->cfg.link[A].propdelay, r->cfg.link[A].qlimit,
+           r->cfg.link[A].qbytes, link_aqm_name(r->cfg.link[A].aqm),
+           link_loss_name(r->cfg.link[impaired(r)].loss), r->cfg.link[impaired(r)].reorder,
+           r->cfg.link[impaired(r)].dup, cc_name(r->cfg.proto.cc),
+           rng_name(r->cfg.rng), r->cfg.seed, r->rep, r->cfg.nsimmax, r->nsim, r->stats.window_full, r->stats.new_ACKs,
+           r->stats.total_ACKs_received, r->stats.packets_resent,
+           r->stats.fast_retransmits, r->stats.packets_fastresent,
+           r->stats.packets_received, r->stats.messages_delivered,
+           r->stats.ntolayer3, r->stats.nlost, r->stats.ncorrupt, r->time,
+           r->metrics.latency_mean, r->metrics.latency_p50, r->metrics.latency_p99,
+           r->metrics.latency_p999, r->metrics.latency_max, r->metrics.goodput,
+           r->metrics.retransmit_ratio, r->metrics.window_mean, r->metrics.window_max,
+           r->stats.rtt_samples, r->stats.timeouts, r->stats.srtt, r->stats.rttvar,
+           r->stats.rto, r->metrics.queue_mean, r->metrics.queue_max,
+           r->metrics.queuedelay_mean, r->metrics.queuedelay_p99, r->metrics.queuedelay_max,
+           r->stats.backpressured, r->metrics.blocked_time,
+           r->stats.acks_alone, r->stats.acks_delayed, r->stats.acks_piggybacked,
+           r->metrics.ack_ratio, r->stats.packets_sacked,
+           r->stats.bytes_delivered, r->stats.bytes_tolayer3, r->stats.header_tolayer3,
+           r->metrics.byte_goodput, r->metrics.header_overhead,
+           r->stats.qdrops, r->stats.reddrops,
+           r->metrics.link_util[A], r->metrics.linkq_mean[A], r->metrics.linkq_max[A],
+           r->metrics.link_util[B], r->metrics.linkq_mean[B], r->metrics.linkq_max[B],
+           r->stats.nreordered, r->stats.nduplicated, r->metrics.loss_burst_mean,
+           r->metrics.cwnd_mean, r->stats.cwnd, r->stats.ssthresh, r->stats.cwnd_reductions);
+  }
+}
+
+static void printjson(const struct run *runs, int n)
+{
+  const struct run *r;
+  int i;
+
+  printf("[\n");
+  for (i = 0; i < n; i++) {
+    r = &runs[i];
+    printf("  {\"protocol\": \"%s\", \"loss\": %g, \"corrupt\": %g, \"direction\": %d, \"lambda\": %g, "
+           "\"window\": %d, \"dupacks\": %d, \"queue\": %d, \"backpressure\": %d, "
+           "\"bidirectional\": %d, \"ackdelay\": %g, \"ackevery\": %d, \"sack\": %d, "
+           "\"checksum\": \"%s\", \"msgsize\": %d, \"msgdist\": \"%s\", "
+           "\"bandwidth\": %g, \"propdelay\": %g, \"linkqueue\": %d, \"linkbytes\": %d, "
+           "\"aqm\": \"%s\", \"lossmodel\": \"%s\", \"reorder\": %g, \"dup\": %g, "
+           "\"cc\": \"%s\", "
+           "\"rng\": \"%s\", \"seed\": %u, \"rep\": %d, "
+           "\"messages\": %d, \"sent\": %d, "
+           "\"window_full\": %d, \"new_ACKs\": %d, \"total_ACKs_received\": %d, "
+           "\"packets_resent\": %d, \"fast_retransmits\": %d, \"packets_fastresent\": %d, "
+           "\"packets_received\": %d, "
+           "\"messages_delivered\": %d, \"ntolayer3\": %d, \"nlost\": %d, "
+           "\"ncorrupt\": %d, \"time\": %f, "
+           "\"latency_mean\": %f, \"latency_p50\": %f, \"latency_p99\": %f, "
+           "\"latency_p999\": %f, \"latency_max\": %f, \"goodput\": %f, "
+           "\"retransmit_ratio\": %f, \"window_mean\": %f, \"window_max\": %d, "
+           "\"rtt_samples\": %d, \"timeouts\": %d, \"srtt\": %f, \"rttvar\": %f, "
+           "\"rto\": %f, \"queue_mean\": %f, \"queue_max\": %d, "
+           "\"queuedelay_mean\": %f, \"queuedelay_p99\": %f, \"queuedelay_max\": %f, "
+           "\"backpressured\": %d, \"blocked_time\": %f, \"acks_alone\": %d, "
+           "\"acks_delayed\": %d, \"acks_piggybacked\": %d, \"ack_ratio\": %f, "
+           "\"packets_sacked\": %d, \"bytes_delivered\": %lld, \"bytes_tolayer3\": %lld, "
+           "\"header_tolayer3\": %lld, \"byte_goodput\": %f, \"header_overhead\": %f, "
+           "\"qdrops\": %d, \"reddrops\": %d, \"link_util_ab\": %f, \"linkq_mean_ab\": %f, "
+           "\"linkq_max_ab\": %d, \"link_util_ba\": %f, \"linkq_mean_ba\": %f, "
+           "\"linkq_max_ba\": %d, \"reordered\": %d, \"duplicated\": %d, "
+           "\"loss_burst_mean\": %f, \"cwnd_mean\": %f, \"cwnd\": %f, \"ssthresh\": %f, "
+           "\"cwnd_reductions\": %d}%s\n",
+           r->cfg.transport->name, r->cfg.lossprob, r->cfg.corruptprob,
+           r->cfg.corruptdirection, r->cfg.lambda, r->cfg.proto.windowsize, r->cfg.proto.dupacks,
+           r->cfg.proto.sendqueue, r->cfg.backpressure,
+           r->cfg.proto.bidirectional, r->cfg.proto.ackdelay, r->cfg.proto.ackevery,
+           r->cfg.proto.sack, cksum_name(r->cfg.proto.checksum),
+           r->cfg.msgsize, msgdist_name(r->cfg.msgdist),
+           r->cfg.link[A].bandwidth, r->cfg.link[A].propdelay, r->cfg.link[A].qlimit,
+           r->cfg.link[A].qbytes, link_aqm_name(r->cfg.link[A].aqm),
+           link_loss_name(r->cfg.link[impaired(r)].loss), r->cfg.link[impaired(r)].reorder,
+           r->cfg.link[impaired(r)].dup, cc_name(r->cfg.proto.cc),
+           rng_name(r->cfg.rng), r->cfg.seed, r->rep, r->cfg.nsimmax, r->nsim, r->stats.window_full, r->stats.new_ACKs,
+           r->stats.total_ACKs_received, r->stats.packets_resent,
+           r->stats.fast_retransmits, r->stats.packets_fastresent,
+           r->stats.packets_received, r->stats.messages_delivered,
+           r->stats.ntolayer3, r->stats.nlost, r->stats.ncorrupt, r->time,
+           r->metrics.latency_mean, r->metrics.latency_p50, r->metrics.latency_p99,
+           r->metrics.latency_p999, r->metrics.latency_max, r->metrics.goodput,
+           r->metrics.retransmit_ratio, r->metrics.window_mean, r->metrics.window_max,
+           r->stats.rtt_samples, r->stats.timeouts, r->stats.srtt, r->stats.rttvar,
+           r->stats.rto, r->metrics.queue_mean, r->metrics.queue_max,
+           r->metrics.queuedelay_mean, r->metrics.queuedelay_p99, r->metrics.queuedelay_max,
+           r->stats.backpressured, r->metrics.blocked_time,
+           r->stats.acks_alone, r->stats.acks_delayed, r->stats.acks_piggybacked,
+           r->metrics.ack_ratio, r->stats.packets_sacked,
+           r->stats.bytes_delivered, r->stats.bytes_tolayer3, r->stats.header_tolayer3,
+           r->metrics.byte_goodput, r->metrics.header_overhead,
+           r->stats.qdrops, r->stats.reddrops,
+           r->metrics.link_util[A], r->metrics.linkq_mean[A], r->metrics.linkq_max[A],
+           r->metrics.link_util[B], r->metrics.linkq_mean[B], r->metrics.linkq_max[B],
+           r->stats.nreordered, r->stats.nduplicated, r->metrics.loss_burst_mean,
+           r->metrics.cwnd_mean, r->stats.cwnd, r->stats.ssthresh, r->stats.cwnd_reductions,
+           (i == n - 1) ? "" : ",");
+  }
+  printf("]\n");
+}
+
+int main(int argc, char **argv)
+{
+  struct spec sp;
+  struct workqueue q;
+  pthread_t *tids;
+  struct timespec t0, t1;
+  FILE *fp = stdin;
+  int i, opt, threads = 0, format = -1, failed;
+
+  while ((opt = getopt(argc, argv, "j:f:")) != -1) {
+    if (opt == 'j')
+      threads = atoi(optarg);
+    else if (opt == 'f' && strcmp(optarg, "csv") == 0)
+      format = 0;
+    else if (opt == 'f' && strcmp(optarg, "json") == 0)
+      format = 1;
+    else
+      usage();
+  }
+  if (optind < argc - 1)
+    usage();
+  if (optind == argc - 1 && (fp = fopen(argv[optind], "r")) == NULL) {
+    perror(argv[optind]);
+    return EXIT_FAILURE;
+  }
+
+  memset(&sp, 0, sizeof(sp));
+  sim_defaults(&sp.base);
+  sp.base.rng = RNG_XOSHIRO;
+  sp.reps = 1;
+  readspec(fp, &sp);
+  if (fp != stdin)
+    fclose(fp);
+  defaultaxis(&sp.loss, sp.base.lossprob);
+  defaultaxis(&sp.corrupt, sp.base.corruptprob);
+  defaultaxis(&sp.lambda, sp.base.lambda);
+  defaultaxis(&sp.window, sp.base.proto.windowsize);
+  defaultaxis(&sp.dupacks, sp.base.proto.dupacks);
+  defaultaxis(&sp.queue, sp.base.proto.sendqueue);
+  defaultaxis(&sp.ackdelay, sp.base.proto.ackdelay);
+  defaultaxis(&sp.ackevery, sp.base.proto.ackevery);
+  defaultaxis(&sp.sack, sp.base.proto.sack);
+  defaultaxis(&sp.msgsize, sp.base.msgsize);
+  defaultaxis(&sp.bandwidth, sp.base.link[A].bandwidth);
+  defaultaxis(&sp.linkqueue, sp.base.link[A].qlimit);
+  defaultaxis(&sp.cc, sp.base.proto.cc);
+  /* the impairments only hit the links direction picks */
+  for (i = 0; i < 2; i++)
+    if (sp.base.corruptdirection == !i) {
+      sp.base.link[i].loss = LOSS_BERNOULLI;
+      sp.base.link[i].reorder = 0.0;
+      sp.base.link[i].dup = 0.0;
+    }
+  if (sp.nprotocols == 0)
+    sp.protocol[sp.nprotocols++] = sp.base.transport;
+  if (threads > 0)
+    sp.threads = threads;
+  if (sp.threads <= 0)
+    sp.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (sp.threads <= 0)
+    sp.threads = 1;
+  if (format >= 0)
+    sp.json = format;
+  if (sp.reps < 1)
+    sp.reps = 1;
+
+  q.runs = makeruns(&sp, &q.nruns);
+  q.next = 0;
+  pthread_mutex_init(&q.lock, NULL);
+  if (sp.threads > q.nruns)
+    sp.threads = q.nruns;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  tids = malloc(sp.threads * sizeof(pthread_t));
+  if (tids == NULL) {
+    fprintf(stderr, "sweep: memory allocation failed\n");
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < sp.threads; i++)
+    if (pthread_create(&tids[i], NULL, worker, &q) != 0) {
+      fprintf(stderr, "sweep: cannot start worker thread\n");
+      return EXIT_FAILURE;
+    }
+  for (i = 0; i < sp.threads; i++)
+    pthread_join(tids[i], NULL);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  if (sp.json)
+    printjson(q.runs, q.nruns);
+  else
+    printcsv(q.runs, q.nruns);
+  for (failed = 0, i = 0; i < q.nruns; i++)
+    failed += !q.runs[i].ok;
+  fprintf(stderr, "sweep: %d runs on %d threads in %.3f s%s\n", q.nruns, sp.threads,
+          (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9,
+          failed ? ", some runs failed" : "");
+
+  pthread_mutex_destroy(&q.lock);
+  free(tids);
+  free(q.runs);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
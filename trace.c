@@ -0,0 +1,190 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "trace.h"
+
+/* ******************************************************************
+   Trace records and trace files.  See trace.h for an overview.
+**********************************************************************/
+
+/* text of the protocol messages, a %d is filled from seq */
+static const char *const trace_fmt[TR_NTYPES] = {
+  [TR_A_NEWMSG]      = "----A: New message arrives, send window is not full, send new messge to layer3!\n",
+  [TR_A_NEWMSG_FULL] = "----A: New message arrives, send window is full\n",
+  [TR_A_NEWMSG_DROP] = "----A: New message arrives, send window is full, drop messge\n",
+  [TR_A_SEND]        = "Sending packet %d to layer 3\n",
+  [TR_A_ACK]         = "----A: uncorrupted ACK %d is received\n",
+  [TR_A_NEWACK]      = "----A: ACK %d is not a duplicate\n",
+  [TR_A_DUPACK]      = "----A: duplicate ACK received, do nothing!\n",
+  [TR_A_DUPACK_N]    = "----A: ACK %d is a duplicate, do nothing!\n",
+  [TR_A_CORRUPTACK]  = "----A: corrupted ACK is received, do nothing!\n",
+  [TR_A_TIMEOUT]     = "----A: time out,resend packets!\n",
+  [TR_A_RESEND]      = "---A: resending packet %d\n",
+  [TR_B_RECV]        = "----B: packet %d is correctly received, send ACK!\n",
+  [TR_B_BADPKT]      = "----B: packet corrupted or not expected sequence number, resend ACK!\n",
+  [TR_B_BUFFER]      = "----B: packet %d is received out of order, buffer it and send ACK!\n",
+  [TR_B_DUP]         = "----B: packet %d was received before, resend ACK!\n",
+  [TR_B_DROP]        = "----B: packet corrupted or outside the receive window, do nothing!\n",
+  [TR_A_FASTRETX]    = "----A: %d duplicate ACKs, fast retransmit!\n",
+  [TR_A_QUEUE]       = "----A: New message arrives, send window is full, queue it (%d queued)\n",
+  [TR_B_DELACK]      = "----B: no data to carry ACK %d, send it alone!\n",
+};
+
+/* print protocol message r, naming the entity that recorded it */
+static void render_fmt(FILE *out, const struct trace_rec *r)
+{
+  const char *fmt = trace_fmt[r->type];
+  char buf[128];
+  const char *name;
+
+  name = strstr(fmt, "-A:");
+  if (name == NULL)
+    name = strstr(fmt, "-B:");
+  if (name != NULL && name[1] != "AB"[r->entity & 1] && strlen(fmt) < sizeof(buf)) {
+    strcpy(buf, fmt);
+    buf[name - fmt + 1] = "AB"[r->entity & 1];
+    fmt = buf;
+  }
+  fprintf(out, fmt, r->seq);
+}
+
+static void render_data(FILE *out, const struct trace_rec *r, const char *data)
+{
+  int i;
+
+  for (i=0; i<r->len && i<TRACE_SHOWDATA; i++)
+    if (data != NULL)
+      fputc(data[i], out);
+    else
+      fputc(r->data[i == 0 ? 0 : 1], out);
+  if (r->len > TRACE_SHOWDATA)
+    fprintf(out, "... (%d bytes)", r->len);
+}
+
+void trace_render(FILE *out, const struct trace_rec *r, const char *data)
+{
+  switch (r->type) {
+  case TR_INSERTEVENT:
+    fprintf(out, "            INSERTEVENT: time is %f\n", r->time);
+    fprintf(out, "            INSERTEVENT: future time will be %f\n", r->aux);
+    break;
+  case TR_ARRIVAL:
+    fprintf(out, "          GENERATE NEXT ARRIVAL: creating new arrival\n");
+    break;
+  case TR_STOPTIMER:
+    fprintf(out, "          STOP TIMER: stopping timer at %f\n", r->time);
+    break;
+  case TR_STARTTIMER:
+    fprintf(out, "          START TIMER: starting timer at %f\n", r->time);
+    break;
+  case TR_LOST:
+    fprintf(out, "          TOLAYER3: packet being lost\n");
+    break;
+  case TR_QDROP:
+    fprintf(out, "          TOLAYER3: link queue full (%d packets), packet dropped\n", r->seq);
+    break;
+  case TR_REDDROP:
+    fprintf(out, "          TOLAYER3: RED drops packet (%d packets queued)\n", r->seq);
+    break;
+  case TR_TOLAYER3:
+    fprintf(out, "          TOLAYER3: seq: %d, ack %d, check: %d ", r->seq, r->ack, r->check);
+    render_data(out, r, data);
+    fprintf(out, "\n");
+    break;
+  case TR_CORRUPT:
+    fprintf(out, "          TOLAYER3: packet being corrupted\n");
+    break;
+  case TR_REORDER:
+    fprintf(out, "          TOLAYER3: packet being reordered, may overtake %d packets\n", r->seq);
+    break;
+  case TR_DUP:
+    fprintf(out, "          TOLAYER3: packet being duplicated\n");
+    break;
+  case TR_SCHEDULE:
+    fprintf(out, "          TOLAYER3: scheduling arrival on other side\n");
+    break;
+  case TR_TOLAYER5:
+    fprintf(out, "          TOLAYER5: data received by application at ");
+    fprintf(out, r->entity == A ? "A: " : "B: ");
+    render_data(out, r, data);
+    fprintf(out, "\n");
+    break;
+  case TR_EVENT:
+    fprintf(out, "\nEVENT time: %f,", r->aux);
+    fprintf(out, "  type: %d", r->seq);
+    if (r->seq == 0)
+      fprintf(out, ", timerinterrupt  ");
+    else if (r->seq == 1)
+      fprintf(out, ", fromlayer5 ");
+    else
+      fprintf(out, ", fromlayer3 ");
+    fprintf(out, " entity: %d\n", r->entity);
+    break;
+  case TR_GIVEMSG:
+    fprintf(out, "          MAINLOOP: data given to student: ");
+    render_data(out, r, data);
+    fprintf(out, "\n");
+    break;
+  case TR_NOMORE:
+    fprintf(out, "          FROM_LAYER5: no more messages to send: \n");
+    break;
+  default:
+    if (r->type < TR_NTYPES && trace_fmt[r->type] != NULL)
+      render_fmt(out, r);
+    else
+      fprintf(out, "unknown trace record type %d\n", r->type);
+  }
+}
+
+
+/********************** trace files **********************/
+
+int trace_open(struct trace_ring *r, const char *path, size_t nrec)
+{
+  size_t n;
+  void *map;
+
+  if (nrec == 0)
+    nrec = TRACE_NREC;
+  for (n = 1; n < nrec; n *= 2)
+    ;
+  memset(r, 0, sizeof(struct trace_ring));
+  r->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (r->fd < 0) {
+    printf("cannot create trace file %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  r->maplen = sizeof(struct trace_hdr) + n * sizeof(struct trace_rec);
+  if (ftruncate(r->fd, r->maplen) < 0 ||
+      (map = mmap(NULL, r->maplen, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, 0)) == MAP_FAILED) {
+    printf("cannot map trace file %s: %s\n", path, strerror(errno));
+    close(r->fd);
+    return -1;
+  }
+  r->hdr = map;
+  r->rec = (struct trace_rec *)(r->hdr + 1);
+  r->mask = n - 1;
+  memcpy(r->hdr->magic, TRACE_MAGIC, sizeof(r->hdr->magic));
+  r->hdr->version = TRACE_VERSION;
+  r->hdr->recsize = sizeof(struct trace_rec);
+  r->hdr->nrec = n;
+  r->hdr->head = 0;
+  return 0;
+}
+
+void trace_close(struct trace_ring *r)
+{
+  uint64_t used;
+
+  used = r->hdr->head < r->hdr->nrec ? r->hdr->head : r->hdr->nrec;
+  munmap(r->hdr, r->maplen);
+  /* the unused tail of the ring need not take up disk space */
+  if (ftruncate(r->fd, sizeof(struct trace_hdr) + used * sizeof(struct trace_rec)) < 0)
+    printf("cannot trim trace file: %s\n", strerror(errno));
+  close(r->fd);
+  memset(r, 0, sizeof(struct trace_ring));
+}
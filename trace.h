@@ -0,0 +1,162 @@
+/* ******************************************************************
+   Event tracing.
+
+   Every trace site of the emulator and the protocols produces one
+   fixed-size struct trace_rec instead of calling printf directly.
+   A simulation without a trace file renders each record to stdout at
+   once, which gives exactly the text the emulator has always printed.
+   A simulation with a trace file (sim_config.tracefile) appends the
+   records to a ring of trace_rec mapped from that file, so tracing
+   costs a 28-byte store per site; the tracedump program renders the
+   file as text afterwards.  When the ring is full the oldest records
+   are overwritten.
+
+   Trace sites are written as
+
+     TRACE_LOG(level, type, entity, n);
+
+   and are only executed when TRACE > level, as before.  Building with
+   -DEMU_TRACE=0 removes them from the program altogether.
+**********************************************************************/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "emulator.h"
+
+/* record types; the protocol messages are printf formats taking seq.
+   They name the entity in its role of a one-way transfer, sender A
+   and receiver B; a record of the other entity, which plays that role
+   in a bidirectional run, is printed with its own name. */
+enum trace_type {
+  /* emulator */
+  TR_INSERTEVENT,       /* aux: time of the new event */
+  TR_ARRIVAL,           /* next layer 5 arrival generated */
+  TR_STOPTIMER,
+  TR_STARTTIMER,
+  TR_LOST,
+  TR_QDROP,             /* seq: packets in the link queue */
+  TR_REDDROP,           /* seq: packets in the link queue */
+  TR_TOLAYER3,          /* seq, ack, check, data */
+  TR_CORRUPT,
+  TR_REORDER,           /* seq: packets it may overtake */
+  TR_DUP,
+  TR_SCHEDULE,
+  TR_TOLAYER5,          /* entity, data */
+  TR_EVENT,             /* main loop; aux: event time, seq: event type */
+  TR_GIVEMSG,           /* data */
+  TR_NOMORE,
+
+  /* protocols */
+  TR_A_NEWMSG,
+  TR_A_NEWMSG_FULL,
+  TR_A_NEWMSG_DROP,
+  TR_A_SEND,
+  TR_A_ACK,
+  TR_A_NEWACK,
+  TR_A_DUPACK,
+  TR_A_DUPACK_N,
+  TR_A_CORRUPTACK,
+  TR_A_TIMEOUT,
+  TR_A_RESEND,
+  TR_B_RECV,
+  TR_B_BADPKT,
+  TR_B_BUFFER,
+  TR_B_DUP,
+  TR_B_DROP,
+  TR_A_FASTRETX,
+  TR_A_QUEUE,
+  TR_B_DELACK,
+
+  TR_NTYPES
+};
+
+#define TRF_DATA    0x1   /* data[] holds payload bytes 0 and 1 */
+#define TRF_MIXED   0x2   /* payload bytes from 2 on differ from byte 1 */
+
+/* one trace site.  The payload is summarised by its length and first
+   two bytes: the emulator's messages repeat one letter, so the first
+   byte and a fill byte render it exactly; TRF_MIXED marks a payload
+   that does not fit this.  Only the first TRACE_SHOWDATA bytes are
+   printed, followed by the length if there are more. */
+struct trace_rec {
+  float time;           /* simulation time */
+  float aux;            /* second time value of some records */
+  int32_t seq;
+  int32_t ack;
+  int32_t check;
+  uint16_t type;        /* enum trace_type */
+  uint8_t entity;       /* A or B */
+  uint8_t flags;        /* TRF_* */
+  char data[2];
+  uint16_t len;         /* payload bytes */
+};
+
+#define TRACE_SHOWDATA 20
+
+#define TRACE_MAGIC   "EMUTRACE"
+#define TRACE_VERSION 4
+#define TRACE_NREC    (1 << 20)  /* default ring size, in records */
+
+/* start of a trace file, followed by nrec records */
+struct trace_hdr {
+  char magic[8];
+  uint32_t version;
+  uint32_t recsize;     /* sizeof(struct trace_rec) */
+  uint64_t nrec;        /* ring size, a power of two */
+  uint64_t head;        /* records written so far */
+};
+
+struct trace_ring {
+  int fd;
+  size_t maplen;
+  struct trace_hdr *hdr;
+  struct trace_rec *rec;
+  uint64_t mask;        /* nrec - 1 */
+};
+
+/* create path holding a ring of at least nrec records (TRACE_NREC if
+   0); returns -1 after printing the reason if that fails */
+extern int trace_open(struct trace_ring *r, const char *path, size_t nrec);
+/* unmap the ring and trim the file to the records written */
+extern void trace_close(struct trace_ring *r);
+
+static inline void trace_put(struct trace_ring *r, const struct trace_rec *rec)
+{
+  r->rec[r->hdr->head++ & r->mask] = *rec;
+}
+
+/* print a record the way the emulator used to print that trace site;
+   data is the full payload if still at hand, else NULL */
+extern void trace_render(FILE *out, const struct trace_rec *rec, const char *data);
+
+/* record a trace site of the simulation running on this thread, see
+   emulator.c; data is NULL or a payload of len bytes */
+extern void trace_emit(int type, int entity, int seq, int ack, int check,
+                       float aux, const char *data, int len);
+
+#ifndef EMU_TRACE
+#define EMU_TRACE 1
+#endif
+
+#if EMU_TRACE
+#define TRACE_AT(level, type, entity, seq, ack, check, aux, data, len) \
+  do {                                                                 \
+    if (TRACE > (level))                                               \
+      trace_emit((type), (entity), (seq), (ack), (check), (aux), (data), (len)); \
+  } while (0)
+#else
+/* the arguments still count as used, but sizeof does not evaluate them */
+#define TRACE_AT(level, type, entity, seq, ack, check, aux, data, len) \
+  do {                                                                 \
+    (void)sizeof(level); (void)sizeof(type); (void)sizeof(entity);     \
+    (void)sizeof(seq); (void)sizeof(ack); (void)sizeof(check);         \
+    (void)sizeof(aux); (void)sizeof(data); (void)sizeof(len);          \
+  } while (0)
+#endif
+
+#define TRACE_LOG(level, type, entity, n) \
+  TRACE_AT(level, type, entity, n, 0, 0, 0.0f, NULL, 0)
+
+#endif
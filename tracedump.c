@@ -0,0 +1,62 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+
+/* ******************************************************************
+   Offline decoder of emulator trace files: prints the records of a
+   file written with EMU_TRACEFILE (see main.c) in the text format of
+   the emulator's own tracing, oldest first.
+
+   usage: tracedump tracefile
+
+   Build:  gcc -o tracedump tracedump.c trace.c
+**********************************************************************/
+
+int main(int argc, char *argv[])
+{
+  struct trace_hdr hdr;
+  struct trace_rec rec;
+  uint64_t first, i;
+  FILE *fp;
+
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s tracefile\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  fp = fopen(argv[1], "rb");
+  if (fp == NULL) {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+  if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+      memcmp(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic)) != 0 ||
+      hdr.version != TRACE_VERSION || hdr.recsize != sizeof(struct trace_rec) ||
+      hdr.nrec == 0 || (hdr.nrec & (hdr.nrec - 1)) != 0) {
+    fprintf(stderr, "%s: not an emulator trace file\n", argv[1]);
+    fclose(fp);
+    return EXIT_FAILURE;
+  }
+
+  /* once the ring has wrapped the oldest record sits at head */
+  first = 0;
+  if (hdr.head > hdr.nrec) {
+    first = hdr.head - hdr.nrec;
+    fprintf(stderr, "%s: the first %llu records were overwritten\n",
+            argv[1], (unsigned long long)first);
+  }
+  for (i = first; i < hdr.head; i++) {
+    /* read sequentially, going back to the start of the ring to wrap */
+    if (((i == first || (i & (hdr.nrec - 1)) == 0) &&
+         fseek(fp, sizeof(hdr) + (i & (hdr.nrec - 1)) * sizeof(rec), SEEK_SET) != 0) ||
+        fread(&rec, sizeof(rec), 1, fp) != 1) {
+      fprintf(stderr, "%s: truncated after %llu records\n",
+              argv[1], (unsigned long long)(i - first));
+      fclose(fp);
+      return EXIT_FAILURE;
+    }
+    trace_render(stdout, &rec, NULL);
+  }
+  fclose(fp);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,24 @@
+#include <string.h>
+#include "transport.h"
+#include "gbn.h"
+#include "sr.h"
+
+/* ******************************************************************
+   Registry of transport protocols.  See transport.h.
+**********************************************************************/
+
+const struct transport_ops *const transports[] = {
+  &gbn_ops,
+  &sr_ops,
+  NULL
+};
+
+const struct transport_ops *transport_byname(const char *name)
+{
+  int i;
+
+  for (i = 0; transports[i] != NULL; i++)
+    if (strcmp(name, transports[i]->name) == 0)
+      return transports[i];
+  return NULL;
+}
@@ -0,0 +1,42 @@
+/* ******************************************************************
+   Transport protocols.
+
+   A protocol is the set of routines the emulator calls at entities A
+   and B - the A_output(), B_input(), ... of the assignment - gathered
+   in a struct transport_ops.  Each protocol keeps its routines static
+   and exports one table, so any number of protocols link into the same
+   program and a simulation picks one at run time (sim_config.transport).
+**********************************************************************/
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "emulator.h"
+
+struct transport_ops {
+  const char *name;
+  void (*A_init)(void);
+  void (*B_init)(void);
+  void (*A_output)(struct msg);
+  void (*A_input)(struct pkt);
+  void (*A_timerinterrupt)(void);
+  /* B_output() is only called when B sends messages too */
+  /* (proto_config.bidirectional)                          */
+  void (*B_output)(struct msg);
+  void (*B_input)(struct pkt);
+  void (*B_timerinterrupt)(void);
+  /* expiry of logical timer id (starttimer_id), NULL if not used */
+  void (*A_timeout)(int id);
+  void (*B_timeout)(int id);
+  /* packet arrivals as buffers (pktbuf.h) lent for the call, instead */
+  /* of A_input()/B_input(); NULL if not used                         */
+  void (*A_input_buf)(const struct pkt *packet);
+  void (*B_input_buf)(const struct pkt *packet);
+};
+
+/* every linked protocol, NULL terminated; the first is the default */
+extern const struct transport_ops *const transports[];
+
+/* NULL if there is no protocol of that name */
+extern const struct transport_ops *transport_byname(const char *name);
+
+#endif
@@ -0,0 +1,143 @@
+#include <string.h>
+#include <limits.h>
+#include "wheel.h"
+
+/* ******************************************************************
+   Hierarchical timing wheel.  See wheel.h for an overview.
+**********************************************************************/
+
+static unsigned long long wheel_tick(double t)
+{
+  return (unsigned long long)(t / WHEEL_TICK);
+}
+
+/* first non-empty level 0 slot at or after slot i, WHEEL_SLOTS if none */
+static int wheel_nextslot(const struct wheel *w, int i)
+{
+  uint64_t bits;
+  int word;
+
+  for (word = i / 64; word < WHEEL_SLOTS / 64; word++, i = word * 64) {
+    bits = w->map[word] & (~(uint64_t)0 << (i % 64));
+    if (bits != 0)
+      return word * 64 + __builtin_ctzll(bits);
+  }
+  return WHEEL_SLOTS;
+}
+
+/* put t in the slot for its tick, relative to the current tick */
+static void wheel_file(struct wheel *w, struct wheel_timer *t)
+{
+  unsigned long long tick, delta;
+  int level;
+
+  tick = t->tick < w->now ? w->now : t->tick;
+  delta = tick - w->now;
+  for (level = 0; level < WHEEL_LEVELS - 1; level++)
+    if (delta < 1ULL << (WHEEL_BITS * (level + 1)))
+      break;
+  if (delta >= 1ULL << (WHEEL_BITS * WHEEL_LEVELS))   /* beyond the wheel */
+    tick = w->now + (1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+  t->level = level;
+  t->slot = (int)((tick >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+  t->prev = NULL;
+  t->next = w->slot[level][t->slot];
+  if (t->next != NULL)
+    t->next->prev = t;
+  w->slot[level][t->slot] = t;
+  if (level == 0)
+    w->map[t->slot / 64] |= (uint64_t)1 << (t->slot % 64);
+}
+
+/* the current tick has reached a multiple of WHEEL_SLOTS: move the */
+/* timers of the higher level slots now due down the wheel          */
+static void wheel_cascade(struct wheel *w)
+{
+  struct wheel_timer *t, *next;
+  int level, top, slot;
+
+  for (top = 1; top < WHEEL_LEVELS - 1; top++)
+    if ((w->now >> (WHEEL_BITS * (top + 1))) << (WHEEL_BITS * (top + 1)) != w->now)
+      break;
+  for (level = top; level >= 1; level--) {
+    slot = (int)((w->now >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+    t = w->slot[level][slot];
+    w->slot[level][slot] = NULL;
+    for (; t != NULL; t = next) {
+      next = t->next;
+      wheel_file(w, t);
+    }
+  }
+}
+
+void wheel_init(struct wheel *w)
+{
+  memset(w, 0, sizeof(struct wheel));
+}
+
+void wheel_add(struct wheel *w, struct wheel_timer *t, double now, double expires)
+{
+  if (w->count == 0 && wheel_tick(now) > w->now)
+    w->now = wheel_tick(now);
+  t->expires = expires;
+  t->tick = wheel_tick(expires);
+  t->seq = w->nextseq++;
+  t->armed = 1;
+  wheel_file(w, t);
+  w->count++;
+}
+
+void wheel_del(struct wheel *w, struct wheel_timer *t)
+{
+  if (t->prev != NULL)
+    t->prev->next = t->next;
+  else
+    w->slot[t->level][t->slot] = t->next;
+  if (t->next != NULL)
+    t->next->prev = t->prev;
+  if (t->level == 0 && w->slot[0][t->slot] == NULL)
+    w->map[t->slot / 64] &= ~((uint64_t)1 << (t->slot % 64));
+  t->prev = t->next = NULL;
+  t->armed = 0;
+  w->count--;
+}
+
+struct wheel_timer *wheel_expire(struct wheel *w, double limit)
+{
+  struct wheel_timer *t, *best;
+  unsigned long long last, target;
+  int i, n;
+
+  last = limit < WHEEL_TICK * (double)ULLONG_MAX / 2 ? wheel_tick(limit) : ULLONG_MAX;
+  for (;;) {
+    if (w->count == 0) {
+      /* nothing to look after: catch up with the caller's clock */
+      if (last != ULLONG_MAX && last > w->now)
+        w->now = last;
+      return NULL;
+    }
+    /* level 0 slot of the current tick, earliest timer first */
+    i = (int)(w->now & (WHEEL_SLOTS - 1));
+    best = NULL;
+    for (t = w->slot[0][i]; t != NULL; t = t->next)
+      if (best == NULL || t->expires < best->expires ||
+          (t->expires == best->expires && t->seq < best->seq))
+        best = t;
+    if (best != NULL) {
+      if (best->expires > limit)
+        return NULL;
+      wheel_del(w, best);
+      return best;
+    }
+    if (w->now >= last)
+      return NULL;
+    /* skip empty slots, stopping at the end of this turn of level 0 */
+    n = wheel_nextslot(w, i + 1);
+    target = w->now + (n - i);
+    if (target > last)
+      target = last;
+    w->now = target;
+    if ((w->now & (WHEEL_SLOTS - 1)) == 0)
+      wheel_cascade(w);
+  }
+}
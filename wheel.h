@@ -0,0 +1,52 @@
+/* ******************************************************************
+   Hierarchical timing wheel (Varghese and Lauck) for the protocols'
+   logical timers.
+
+   Time is cut into ticks of WHEEL_TICK time units.  Level 0 has one
+   slot per tick for the next WHEEL_SLOTS ticks; each higher level has
+   slots WHEEL_SLOTS times as wide, and its slot is cascaded into the
+   level below when the wheel reaches it.  Arming and cancelling a
+   timer are O(1); finding the next one to expire skips empty level 0
+   slots with a bitmap.  A timer keeps its exact expiry time, the
+   ticks only sort timers into slots, so timers fire at the same
+   moment an event scheduled for that time would.
+**********************************************************************/
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#include <stdint.h>
+
+#define WHEEL_TICK   1.0     /* time units per tick */
+#define WHEEL_BITS   8
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4       /* ticks up to 2^32 ahead */
+
+struct wheel_timer {
+  double expires;         /* exact expiry time */
+  unsigned long long tick;
+  unsigned long seq;      /* arming order, breaks ties on expires */
+  int armed;
+  int level, slot;        /* where the timer is filed */
+  int entity, id;         /* owner, for the caller */
+  struct wheel_timer *prev;
+  struct wheel_timer *next;
+};
+
+struct wheel {
+  unsigned long long now; /* current tick: nothing earlier is pending */
+  int count;              /* armed timers */
+  unsigned long nextseq;
+  struct wheel_timer *slot[WHEEL_LEVELS][WHEEL_SLOTS];
+  uint64_t map[WHEEL_SLOTS / 64]; /* non-empty level 0 slots */
+};
+
+extern void wheel_init(struct wheel *w);
+/* arm t to expire at time expires; now is the current time, which an */
+/* idle wheel catches up with                                         */
+extern void wheel_add(struct wheel *w, struct wheel_timer *t, double now, double expires);
+extern void wheel_del(struct wheel *w, struct wheel_timer *t);
+/* disarm and return the earliest timer expiring at or before limit, */
+/* NULL if there is none                                             */
+extern struct wheel_timer *wheel_expire(struct wheel *w, double limit);
+
+#endif